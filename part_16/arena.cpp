@@ -0,0 +1,32 @@
+#include "arena.hpp"
+
+#include <cstring>
+
+static constexpr size_t MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+
+Arena::~Arena() {
+    for (auto *chunk : chunks_) {
+        delete[] chunk;
+    }
+}
+
+std::string_view Arena::copy(std::string_view str) {
+    if (str.empty()) {
+        return {};
+    }
+    auto *data = static_cast<char *>(allocate(str.size(), 1));
+    std::memcpy(data, str.data(), str.size());
+    return std::string_view(data, str.size());
+}
+
+void Arena::grow(size_t min_size) {
+    auto size = next_chunk_size_ > min_size ? next_chunk_size_ : min_size;
+    auto *chunk = new char[size];
+    chunks_.push_back(chunk);
+    reserved_ += size;
+    cursor_ = reinterpret_cast<uintptr_t>(chunk);
+    limit_ = cursor_ + size;
+    if (next_chunk_size_ < MAX_CHUNK_SIZE) {
+        next_chunk_size_ *= 2;
+    }
+}
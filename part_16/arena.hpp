@@ -0,0 +1,84 @@
+#ifndef ARENA_HPP_
+#define ARENA_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// 只读的连续数组视图，元素存放在 Arena 中
+template <typename T>
+class ArenaArray {
+   public:
+    ArenaArray() = default;
+    ArenaArray(const T *data, size_t size) : data_(data), size_(size) {}
+
+    const T *begin() const { return data_; }
+    const T *end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T &operator[](size_t i) const { return data_[i]; }
+
+   private:
+    const T *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// 一次编译使用的 bump 分配器。
+// 分配的对象永不析构，因此只接受 trivially destructible 的类型；
+// 释放时只需归还少量按倍数增长的内存块，与对象数量无关。
+class Arena {
+   public:
+    explicit Arena(size_t first_chunk_size = 64 * 1024) : next_chunk_size_(first_chunk_size) {}
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t size, size_t align) {
+        auto p = (cursor_ + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+        if (p + size > limit_) {
+            grow(size + align);
+            p = (cursor_ + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+        }
+        cursor_ = p + size;
+        return reinterpret_cast<void *>(p);
+    }
+
+    template <typename T, typename... Args>
+    T *make(Args &&...args) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    ArenaArray<T> array(const std::vector<T> &items) {
+        static_assert(std::is_trivially_copyable<T>::value, "arena arrays are copied bytewise");
+        if (items.empty()) {
+            return {};
+        }
+        auto *data = static_cast<T *>(allocate(sizeof(T) * items.size(), alignof(T)));
+        std::copy(items.begin(), items.end(), data);
+        return ArenaArray<T>(data, items.size());
+    }
+
+    std::string_view copy(std::string_view str);
+
+    // 已分配给各内存块的总字节数
+    size_t reserved() const { return reserved_; }
+
+   private:
+    void grow(size_t min_size);
+
+    std::vector<char *> chunks_;
+    uintptr_t cursor_ = 0;
+    uintptr_t limit_ = 0;
+    size_t next_chunk_size_;
+    size_t reserved_ = 0;
+};
+
+#endif
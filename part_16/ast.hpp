@@ -1,11 +1,13 @@
 #ifndef AST_HPP
 #define AST_HPP
 
-#include <memory>
-#include <string>
-#include <vector>
+#include <cstdint>
+#include <string_view>
 
+#include "arena.hpp"
+#include "identifier.hpp"
 #include "token.hpp"
+#include "value.hpp"
 
 class BinaryOpNode;
 class NumNode;
@@ -24,150 +26,191 @@ class ProcedureCallNode;
 
 class Visitor {
    public:
-    virtual void visit(const std::shared_ptr<BinaryOpNode> &node) = 0;
-    virtual void visit(const std::shared_ptr<NumNode> &node) = 0;
-    virtual void visit(const std::shared_ptr<UnaryOpNode> &node) = 0;
-    virtual void visit(const std::shared_ptr<CompoundNode> &node) = 0;
-    virtual void visit(const std::shared_ptr<AssignNode> &node) = 0;
-    virtual void visit(const std::shared_ptr<VarNode> &node) = 0;
-    virtual void visit(const std::shared_ptr<NoOpNode> &node) = 0;
-    virtual void visit(const std::shared_ptr<ProgramNode> &node) = 0;
-    virtual void visit(const std::shared_ptr<BlockNode> &node) = 0;
-    virtual void visit(const std::shared_ptr<VarDeclNode> &node) = 0;
-    virtual void visit(const std::shared_ptr<TypeNode> &node) = 0;
-    virtual void visit(const std::shared_ptr<ProcedureDecl> &node) = 0;
-    virtual void visit(const std::shared_ptr<ParamNode> &node) = 0;
-    virtual void visit(const std::shared_ptr<ProcedureCallNode> &node) = 0;
+    virtual void visit(BinaryOpNode *node) = 0;
+    virtual void visit(NumNode *node) = 0;
+    virtual void visit(UnaryOpNode *node) = 0;
+    virtual void visit(CompoundNode *node) = 0;
+    virtual void visit(AssignNode *node) = 0;
+    virtual void visit(VarNode *node) = 0;
+    virtual void visit(NoOpNode *node) = 0;
+    virtual void visit(ProgramNode *node) = 0;
+    virtual void visit(BlockNode *node) = 0;
+    virtual void visit(VarDeclNode *node) = 0;
+    virtual void visit(TypeNode *node) = 0;
+    virtual void visit(ProcedureDecl *node) = 0;
+    virtual void visit(ParamNode *node) = 0;
+    virtual void visit(ProcedureCallNode *node) = 0;
+};
+
+// 语义分析把名字解析为 (作用域层次, 槽位)，写在引用它的节点上：
+// 执行时按层次找到该作用域的帧，再按槽位下标访问，不再按名字查找
+struct Binding {
+    // 声明该名字的作用域的层次，全局为 1；0 表示尚未解析
+    uint32_t depth_ = 0;
+    // 变量（包括参数）在帧中的下标，或者过程在所在作用域的过程中的序号
+    uint32_t slot_ = 0;
+};
+
+// 所有节点都分配在 Arena 中，由 Arena 统一释放，节点之间用裸指针引用
+class ASTNode {
+   public:
+    virtual void visit(Visitor *visitor) = 0;
 };
 
-class ASTNode {
+// 表达式节点（一元、二元运算，字面量，变量）。语义分析把推导出的静态类型写在 type_ 上，
+// 执行引擎据此直接选择整数或者实数运算
+class ExprNode : public ASTNode {
    public:
-    virtual void visit(const std::shared_ptr<Visitor> &visitor) = 0;
+    ValueType type_ = TYPE_UNKNOWN;
 };
 
-class UnaryOpNode : public ASTNode, public std::enable_shared_from_this<UnaryOpNode> {
+// 表达式的位置上只会出现 ExprNode
+inline ValueType typeOf(const ASTNode *expr) {
+    return static_cast<const ExprNode *>(expr)->type_;
+}
+
+class UnaryOpNode : public ExprNode {
    public:
-    UnaryOpNode(const Token &op, const std::shared_ptr<ASTNode> &expr) : token_(op), expr_(std::move(expr)) {}
+    UnaryOpNode(const Token &op, ASTNode *expr) : token_(op), expr_(expr) {}
 
-    void visit(const std::shared_ptr<Visitor> &visitor) override { visitor->visit(shared_from_this()); }
+    void visit(Visitor *visitor) override { visitor->visit(this); }
 
     Token token_;
-    std::shared_ptr<ASTNode> expr_;
+    ASTNode *expr_;
 };
 
-class BinaryOpNode : public ASTNode, public std::enable_shared_from_this<BinaryOpNode> {
+class BinaryOpNode : public ExprNode {
    public:
-    BinaryOpNode(std::shared_ptr<ASTNode> left, Token op, std::shared_ptr<ASTNode> right)
-        : left_(std::move(left)), op_(op), right_(std::move(right)) {}
+    BinaryOpNode(ASTNode *left, Token op, ASTNode *right) : left_(left), right_(right), op_(op) {}
 
-    void visit(const std::shared_ptr<Visitor> &visitor) override { visitor->visit(shared_from_this()); }
+    void visit(Visitor *visitor) override { visitor->visit(this); }
 
-    std::shared_ptr<ASTNode> left_;
-    std::shared_ptr<ASTNode> right_;
+    ASTNode *left_;
+    ASTNode *right_;
     Token op_;
 };
 
 // 表示"BEGIN ... END" 块
-class CompoundNode : public ASTNode, public std::enable_shared_from_this<CompoundNode> {
+class CompoundNode : public ASTNode {
    public:
-    explicit CompoundNode(std::vector<std::shared_ptr<ASTNode>> children) : children_(std::move(children)) {}
-    void visit(const std::shared_ptr<Visitor> &visitor) override { visitor->visit(shared_from_this()); }
-    std::vector<std::shared_ptr<ASTNode>> children_;
+    explicit CompoundNode(ArenaArray<ASTNode *> children) : children_(children) {}
+    void visit(Visitor *visitor) override { visitor->visit(this); }
+    ArenaArray<ASTNode *> children_;
 };
 
-class AssignNode : public ASTNode, public std::enable_shared_from_this<AssignNode> {
+class AssignNode : public ASTNode {
    public:
-    AssignNode(std::string left, Token op, std::shared_ptr<ASTNode> right) : left_(left), token_(op), right_(right) {}
-    void visit(const std::shared_ptr<Visitor> &visitor) override { visitor->visit(shared_from_this()); }
-    std::string left_;
-    std::shared_ptr<ASTNode> right_;
+    AssignNode(Identifier left, Token op, ASTNode *right) : left_(left), right_(right), token_(op) {}
+    void visit(Visitor *visitor) override { visitor->visit(this); }
+    Identifier left_;
+    ASTNode *right_;
     Token token_;
+    // 赋值目标
+    Binding binding_;
+    // 赋值目标的类型；右侧为 INTEGER 而目标为 REAL 时执行引擎先转换
+    ValueType type_ = TYPE_UNKNOWN;
 };
 
-class VarNode : public ASTNode, public std::enable_shared_from_this<VarNode> {
+class VarNode : public ExprNode {
    public:
-    explicit VarNode(Token token) : token_(token), value_(std::move(token.str_)) {}
-    void visit(const std::shared_ptr<Visitor> &visitor) override { visitor->visit(shared_from_this()); }
+    explicit VarNode(Token token) : token_(token), id_(token.id_) {}
+    void visit(Visitor *visitor) override { visitor->visit(this); }
     Token token_;
-    std::string value_;
+    Identifier id_;
+    // 变量引用，或者变量、参数声明本身
+    Binding binding_;
 };
 
-class NoOpNode : public ASTNode, public std::enable_shared_from_this<NoOpNode> {
+class NoOpNode : public ASTNode {
    public:
     NoOpNode() = default;
-    void visit(const std::shared_ptr<Visitor> &visitor) override { visitor->visit(shared_from_this()); }
+    void visit(Visitor *visitor) override { visitor->visit(this); }
 };
 
-class NumNode : public ASTNode, public std::enable_shared_from_this<NumNode> {
+// 字面量的值由词法分析器解析好，存放在 token 中：INTEGER_CONST 为 int64_t，REAL_CONST 为 double
+class NumNode : public ExprNode {
    public:
-    NumNode(Token token) : token_(token) { value_ = token.value_; }
+    NumNode(Token token) : token_(token) {}
+
+    void visit(Visitor *visitor) override { visitor->visit(this); }
+
+    bool isReal() const { return token_.type_ == REAL_CONST; }
+    int64_t integer() const { return token_.value_; }
+    double real() const { return token_.real_value_; }
 
-    void visit(const std::shared_ptr<Visitor> &visitor) override { visitor->visit(shared_from_this()); }
     Token token_;
-    int value_;
 };
 
-class ProgramNode : public ASTNode, public std::enable_shared_from_this<ProgramNode> {
+class ProgramNode : public ASTNode {
    public:
-    ProgramNode(std::string name, std::shared_ptr<BlockNode> block) : name_(std::move(name)), block_(block) {}
+    ProgramNode(Identifier name, BlockNode *block) : name_(name), block_(block) {}
 
-    void visit(const std::shared_ptr<Visitor> &visitor) override { visitor->visit(shared_from_this()); }
+    void visit(Visitor *visitor) override { visitor->visit(this); }
 
-    std::string name_;
-    std::shared_ptr<BlockNode> block_;
+    Identifier name_;
+    BlockNode *block_;
 };
 
-class BlockNode : public ASTNode, public std::enable_shared_from_this<BlockNode> {
+class BlockNode : public ASTNode {
    public:
-    BlockNode(std::vector<std::shared_ptr<ASTNode>> declarations, std::shared_ptr<CompoundNode> compound_statement)
-        : declarations_(declarations), compound_statement_(compound_statement) {}
-    void visit(const std::shared_ptr<Visitor> &visitor) override { visitor->visit(shared_from_this()); }
-    std::shared_ptr<CompoundNode> compound_statement_;
-    std::vector<std::shared_ptr<ASTNode>> declarations_;
+    BlockNode(ArenaArray<ASTNode *> declarations, CompoundNode *compound_statement)
+        : compound_statement_(compound_statement), declarations_(declarations) {}
+    void visit(Visitor *visitor) override { visitor->visit(this); }
+    CompoundNode *compound_statement_;
+    ArenaArray<ASTNode *> declarations_;
+    // 这个作用域的帧中变量（包括参数）的个数，由语义分析填写
+    uint32_t frame_size_ = 0;
 };
 
-class VarDeclNode : public ASTNode, public std::enable_shared_from_this<VarDeclNode> {
+class VarDeclNode : public ASTNode {
    public:
-    VarDeclNode(std::shared_ptr<VarNode> var_node, std::shared_ptr<TypeNode> type_node)
-        : var_node_(var_node), type_node_(type_node) {}
-    void visit(const std::shared_ptr<Visitor> &visitor) override { visitor->visit(shared_from_this()); }
-    std::shared_ptr<VarNode> var_node_;
-    std::shared_ptr<TypeNode> type_node_;
+    VarDeclNode(VarNode *var_node, TypeNode *type_node) : var_node_(var_node), type_node_(type_node) {}
+    void visit(Visitor *visitor) override { visitor->visit(this); }
+    VarNode *var_node_;
+    TypeNode *type_node_;
 };
 
-class TypeNode : public ASTNode, public std::enable_shared_from_this<TypeNode> {
+class TypeNode : public ASTNode {
    public:
-    TypeNode(Token token) : token_(token) {}
-    void visit(const std::shared_ptr<Visitor> &visitor) override { visitor->visit(shared_from_this()); }
-    std::string value() const { return token_.str_; }
+    TypeNode(Token token, Identifier id) : token_(token), id_(id) {}
+    void visit(Visitor *visitor) override { visitor->visit(this); }
     Token token_;
+    // 类型名（INTEGER、REAL）的驻留编号
+    Identifier id_;
 };
 
-class ParamNode : public ASTNode, public std::enable_shared_from_this<ParamNode> {
+class ParamNode : public ASTNode {
    public:
-    ParamNode(std::shared_ptr<VarNode> var_node, std::shared_ptr<TypeNode> type_node)
-        : var_node_(std::move(var_node)), type_node_(std::move(type_node)) {}
-    void visit(const std::shared_ptr<Visitor> &visitor) override { visitor->visit(shared_from_this()); }
-    std::shared_ptr<VarNode> var_node_;
-    std::shared_ptr<TypeNode> type_node_;
+    ParamNode(VarNode *var_node, TypeNode *type_node) : var_node_(var_node), type_node_(type_node) {}
+    void visit(Visitor *visitor) override { visitor->visit(this); }
+    VarNode *var_node_;
+    TypeNode *type_node_;
 };
 
-class ProcedureDecl : public ASTNode, public std::enable_shared_from_this<ProcedureDecl> {
+class ProcedureDecl : public ASTNode {
    public:
-    ProcedureDecl(std::string proc_name, std::vector<std::shared_ptr<ParamNode>> params, std::shared_ptr<BlockNode> block)
-        : proc_name_(std::move(proc_name)), params_(std::move(params)), block_(std::move(block)) {}
-    void visit(const std::shared_ptr<Visitor> &visitor) override { visitor->visit(shared_from_this()); }
-    std::string proc_name_;
-    std::shared_ptr<BlockNode> block_;
-    std::vector<std::shared_ptr<ParamNode>> params_;
-};
-
-class ProcedureCallNode : public ASTNode, public std::enable_shared_from_this<ProcedureCallNode> {
-public:
-    ProcedureCallNode(std::string proc_name, std::vector<std::shared_ptr<ASTNode>> params, Token token) : proc_name_(std::move(proc_name)), actual_params_(std::move(params)), token_(token) {}
-    std::string proc_name_;
-    std::vector<std::shared_ptr<ASTNode>> actual_params_;
+    ProcedureDecl(Identifier proc_name, ArenaArray<ParamNode *> params, BlockNode *block, uint32_t body_offset = 0)
+        : proc_name_(proc_name), block_(block), params_(params), body_offset_(body_offset) {}
+    void visit(Visitor *visitor) override { visitor->visit(this); }
+    Identifier proc_name_;
+    // 惰性分析时为空，只记录过程体的起点 body_offset_，由 ParsedProgram::body() 在第一次用到时建立
+    BlockNode *block_;
+    ArenaArray<ParamNode *> params_;
+    uint32_t body_offset_;
+    // 过程名所在的作用域以及过程在其中的序号
+    Binding binding_;
+};
+
+class ProcedureCallNode : public ASTNode {
+   public:
+    ProcedureCallNode(Identifier proc_name, ArenaArray<ASTNode *> params, Token token)
+        : proc_name_(proc_name), actual_params_(params), token_(token) {}
+    void visit(Visitor *visitor) override { visitor->visit(this); }
+    Identifier proc_name_;
+    ArenaArray<ASTNode *> actual_params_;
     Token token_;
+    // 被调用的过程
+    Binding binding_;
 };
 
 #endif
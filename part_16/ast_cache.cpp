@@ -0,0 +1,365 @@
+#include "ast_cache.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+#include "identifier.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_MMAP 1
+#else
+#include <fstream>
+#endif
+
+namespace {
+
+constexpr char MAGIC[8] = {'P', 'A', 'S', 'F', 'L', 'A', 'T', '\0'};
+
+// 读到的值不同说明写入文件的机器字节序不同
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct CacheHeader {
+    char magic_[8];
+    uint32_t version_;
+    uint32_t byte_order_;
+    uint32_t token_size_;
+    NodeIndex root_;
+    SourceHash source_hash_;
+    uint64_t source_size_;
+    uint32_t node_count_;
+    uint32_t extra_count_;
+    uint32_t number_count_;
+    uint32_t name_count_;
+    uint64_t name_bytes_;
+    uint64_t file_size_;
+    // 头部之后全部内容的哈希，写入时核对
+    uint64_t body_checksum_;
+};
+
+// 各数组在文件中的偏移，完全由头部中的数量决定
+struct Layout {
+    size_t kinds_;
+    size_t lhs_;
+    size_t rhs_;
+    size_t tokens_;
+    size_t extra_;
+    size_t numbers_;
+    size_t types_;
+    size_t name_offsets_;  // name_count_ + 1 个 uint32_t，第 i 个名字为 [offsets[i], offsets[i + 1])
+    size_t name_chars_;
+    size_t size_;
+};
+
+constexpr size_t align8(size_t offset) {
+    return (offset + 7) & ~static_cast<size_t>(7);
+}
+
+// 头部之后的内容，即 body_checksum_ 覆盖的范围
+constexpr size_t BODY_OFFSET = align8(sizeof(CacheHeader));
+
+uint64_t bodyChecksum(const char *file, size_t size) {
+    return hashSource(std::string_view(file + BODY_OFFSET, size - BODY_OFFSET)).low_;
+}
+
+Layout layoutOf(const CacheHeader &header) {
+    Layout layout;
+    size_t offset = BODY_OFFSET;
+    auto place = [&](size_t bytes) {
+        auto at = offset;
+        offset = align8(offset + bytes);
+        return at;
+    };
+    layout.kinds_ = place(header.node_count_ * sizeof(NodeKind));
+    layout.lhs_ = place(header.node_count_ * sizeof(uint32_t));
+    layout.rhs_ = place(header.node_count_ * sizeof(uint32_t));
+    layout.tokens_ = place(header.node_count_ * sizeof(Token));
+    layout.extra_ = place(header.extra_count_ * sizeof(uint32_t));
+    layout.numbers_ = place(header.number_count_ * sizeof(Value));
+    layout.types_ = place(header.node_count_ * sizeof(ValueType));
+    layout.name_offsets_ = place((static_cast<size_t>(header.name_count_) + 1) * sizeof(uint32_t));
+    layout.name_chars_ = place(header.name_bytes_);
+    layout.size_ = offset;
+    return layout;
+}
+
+std::runtime_error ioError(const std::string &what, const std::string &path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+// 整个文件的只读内容；文件不存在或者为空时返回 nullptr
+std::shared_ptr<const void> mapFile(const std::string &path, size_t &size) {
+#ifdef HAVE_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    size = static_cast<size_t>(st.st_size);
+    auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+    return std::shared_ptr<const void>(mapping, [size](const void *p) { munmap(const_cast<void *>(p), size); });
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in || in.tellg() <= 0) {
+        return nullptr;
+    }
+    size = static_cast<size_t>(in.tellg());
+    // 按 8 字节对齐，与映射一样可以直接按数组访问
+    auto buffer = std::make_shared<std::vector<uint64_t>>((size + 7) / 8);
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char *>(buffer->data()), static_cast<std::streamsize>(size))) {
+        return nullptr;
+    }
+    return std::shared_ptr<const void>(buffer, buffer->data());
+#endif
+}
+
+void writeFile(const std::string &path, const std::string &data) {
+#ifdef HAVE_MMAP
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        throw ioError("cannot create", path);
+    }
+    size_t written = 0;
+    while (written < data.size()) {
+        auto n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            auto error = ioError("cannot write", path);
+            close(fd);
+            unlink(path.c_str());
+            throw error;
+        }
+        written += static_cast<size_t>(n);
+    }
+    if (close(fd) != 0) {
+        auto error = ioError("cannot write", path);
+        unlink(path.c_str());
+        throw error;
+    }
+#else
+    std::ofstream out(path, std::ios::binary);
+    if (!out.write(data.data(), static_cast<std::streamsize>(data.size()))) {
+        throw ioError("cannot write", path);
+    }
+#endif
+}
+
+// 同一进程中的多个线程也使用不同的临时文件
+std::string tempSuffix() {
+    static std::atomic<uint64_t> counter{0};
+#ifdef HAVE_MMAP
+    auto pid = static_cast<uint64_t>(getpid());
+#else
+    uint64_t pid = 0;
+#endif
+    return ".tmp." + std::to_string(pid) + "." + std::to_string(counter.fetch_add(1));
+}
+
+template <typename T>
+FlatArray<T> arrayAt(const char *base, size_t offset, size_t size) {
+    return FlatArray<T>(reinterpret_cast<const T *>(base + offset), size);
+}
+
+template <typename T>
+void copyArray(std::string &image, size_t offset, FlatArray<T> items) {
+    if (items.size() != 0) {
+        std::memcpy(&image[offset], items.data(), items.size() * sizeof(T));
+    }
+}
+
+}  // namespace
+
+namespace {
+
+uint64_t rotl(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xFF51AFD7ED558CCDULL;
+    k ^= k >> 33;
+    k *= 0xC4CEB9FE1A85EC53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+}  // namespace
+
+// MurmurHash3 x64_128：每次处理 16 字节，两路状态互相混合
+SourceHash hashSource(std::string_view text) {
+    constexpr uint64_t C1 = 0x87C37B91114253D5ULL;
+    constexpr uint64_t C2 = 0x4CF5AD432745937FULL;
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+    size_t i = 0;
+    for (; i + 16 <= text.size(); i += 16) {
+        uint64_t k1, k2;
+        std::memcpy(&k1, text.data() + i, 8);
+        std::memcpy(&k2, text.data() + i + 8, 8);
+        h1 ^= rotl(k1 * C1, 31) * C2;
+        h1 = (rotl(h1, 27) + h2) * 5 + 0x52DCE729;
+        h2 ^= rotl(k2 * C2, 33) * C1;
+        h2 = (rotl(h2, 31) + h1) * 5 + 0x38495AB5;
+    }
+    auto rest = text.size() - i;
+    if (rest > 8) {
+        uint64_t k2 = 0;
+        std::memcpy(&k2, text.data() + i + 8, rest - 8);
+        h2 ^= rotl(k2 * C2, 33) * C1;
+    }
+    if (rest > 0) {
+        uint64_t k1 = 0;
+        std::memcpy(&k1, text.data() + i, rest < 8 ? rest : 8);
+        h1 ^= rotl(k1 * C1, 31) * C2;
+    }
+    h1 ^= text.size();
+    h2 ^= text.size();
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix(h1);
+    h2 = fmix(h2);
+    h1 += h2;
+    h2 += h1;
+    return SourceHash{h1, h2};
+}
+
+AstCache::AstCache(std::string directory) : directory_(std::move(directory)) {
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error) {
+        throw std::runtime_error("cannot create cache directory " + directory_ + ": " + error.message());
+    }
+}
+
+std::string AstCache::path(const SourceHash &hash) const {
+    char name[48];
+    std::snprintf(name, sizeof(name), "%016llx%016llx.ast", static_cast<unsigned long long>(hash.high_),
+                  static_cast<unsigned long long>(hash.low_));
+    return (std::filesystem::path(directory_) / name).string();
+}
+
+std::optional<FlatAST> AstCache::load(const std::shared_ptr<const Source> &source) const {
+    auto text = source->text();
+    auto hash = hashSource(text);
+    size_t size = 0;
+    auto storage = mapFile(path(hash), size);
+    if (storage == nullptr || size < sizeof(CacheHeader)) {
+        return std::nullopt;
+    }
+    auto base = static_cast<const char *>(storage.get());
+    CacheHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic_, MAGIC, sizeof(MAGIC)) != 0 || header.version_ != VERSION ||
+        header.byte_order_ != BYTE_ORDER_MARK || header.token_size_ != sizeof(Token) || header.source_hash_ != hash ||
+        header.source_size_ != text.size() || header.file_size_ != size || header.name_bytes_ > size ||
+        header.root_ >= header.node_count_ || layoutOf(header).size_ != size) {
+        return std::nullopt;
+    }
+    auto layout = layoutOf(header);
+
+    FlatAST ast;
+    ast.kinds_ = arrayAt<NodeKind>(base, layout.kinds_, header.node_count_);
+    ast.lhs_ = arrayAt<uint32_t>(base, layout.lhs_, header.node_count_);
+    ast.rhs_ = arrayAt<uint32_t>(base, layout.rhs_, header.node_count_);
+    ast.tokens_ = arrayAt<Token>(base, layout.tokens_, header.node_count_);
+    ast.extra_ = arrayAt<uint32_t>(base, layout.extra_, header.extra_count_);
+    ast.numbers_ = arrayAt<Value>(base, layout.numbers_, header.number_count_);
+    ast.types_ = arrayAt<ValueType>(base, layout.types_, header.node_count_);
+    auto name_offsets = arrayAt<uint32_t>(base, layout.name_offsets_, header.name_count_ + 1);
+    ast.names_.reserve(header.name_count_);
+    for (uint32_t i = 0; i < header.name_count_; ++i) {
+        auto begin = name_offsets[i];
+        auto end = name_offsets[i + 1];
+        if (begin > end || end > header.name_bytes_) {
+            return std::nullopt;
+        }
+        ast.names_.push_back(identifiers().intern(std::string_view(base + layout.name_chars_ + begin, end - begin)));
+    }
+    ast.root_ = header.root_;
+    ast.source_ = source;
+    ast.storage_ = std::move(storage);
+    return ast;
+}
+
+void AstCache::store(const FlatAST &ast) const {
+    // 没有通过语义分析的 AST 没有各节点的类型，缓存之后会按 TYPE_UNKNOWN 执行
+    if (ast.types_.size() != ast.size()) {
+        throw std::runtime_error("cannot cache a flat AST that has not been analyzed");
+    }
+    std::string names;
+    std::vector<uint32_t> name_offsets = {0};
+    for (auto name : ast.names_) {
+        names += identifiers().name(name);
+        name_offsets.push_back(static_cast<uint32_t>(names.size()));
+    }
+
+    auto text = ast.source_->text();
+    CacheHeader header = {};
+    std::memcpy(header.magic_, MAGIC, sizeof(MAGIC));
+    header.version_ = VERSION;
+    header.byte_order_ = BYTE_ORDER_MARK;
+    header.token_size_ = sizeof(Token);
+    header.root_ = ast.root_;
+    header.source_hash_ = hashSource(text);
+    header.source_size_ = text.size();
+    header.node_count_ = static_cast<uint32_t>(ast.size());
+    header.extra_count_ = static_cast<uint32_t>(ast.extra_.size());
+    header.number_count_ = static_cast<uint32_t>(ast.numbers_.size());
+    header.name_count_ = static_cast<uint32_t>(ast.names_.size());
+    header.name_bytes_ = names.size();
+    auto layout = layoutOf(header);
+    header.file_size_ = layout.size_;
+
+    // 先在内存中拼好整个文件，填充部分为 0
+    std::string image(layout.size_, '\0');
+    copyArray(image, layout.kinds_, ast.kinds_);
+    copyArray(image, layout.lhs_, ast.lhs_);
+    copyArray(image, layout.rhs_, ast.rhs_);
+    copyArray(image, layout.tokens_, ast.tokens_);
+    copyArray(image, layout.extra_, ast.extra_);
+    copyArray(image, layout.numbers_, ast.numbers_);
+    copyArray(image, layout.types_, ast.types_);
+    std::memcpy(&image[layout.name_offsets_], name_offsets.data(), name_offsets.size() * sizeof(uint32_t));
+    std::memcpy(&image[layout.name_chars_], names.data(), names.size());
+    // 头部最后写入，其中的校验和覆盖之后的全部内容
+    header.body_checksum_ = bodyChecksum(image.data(), image.size());
+    std::memcpy(&image[0], &header, sizeof(header));
+
+    auto target = path(header.source_hash_);
+    auto temp = target + tempSuffix();
+    writeFile(temp, image);
+    // 读回临时文件核对校验和，没有完整写入的文件不会改名为缓存文件
+    size_t size = 0;
+    auto written = mapFile(temp, size);
+    if (written == nullptr || size != image.size() ||
+        bodyChecksum(static_cast<const char *>(written.get()), size) != header.body_checksum_) {
+        std::remove(temp.c_str());
+        throw std::runtime_error("cannot verify " + temp);
+    }
+    written.reset();
+    if (std::rename(temp.c_str(), target.c_str()) != 0) {
+        auto error = ioError("cannot rename", temp);
+        std::remove(temp.c_str());
+        throw error;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef AST_CACHE_HPP_
+#define AST_CACHE_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "flat_ast.hpp"
+#include "source.hpp"
+
+// 源码内容的 128 位哈希，作为缓存的 key。碰撞的概率可以忽略，缓存文件中不保存源码本身
+struct SourceHash {
+    uint64_t low_;
+    uint64_t high_;
+
+    bool operator==(const SourceHash &other) const { return low_ == other.low_ && high_ == other.high_; }
+    bool operator!=(const SourceHash &other) const { return !(*this == other); }
+};
+
+SourceHash hashSource(std::string_view text);
+
+// 已通过语义分析的扁平 AST 的二进制缓存。每个源码对应目录中的一个文件，以源码内容的哈希命名。
+// 文件由定长的头部和依次排列、按 8 字节对齐的各个数组组成，数组中只有下标、不含指针，
+// 命中时只读映射（mmap）整个文件，FlatAST 的视图直接指向映射，不需要反序列化；
+// 只有标识符的名字需要重新驻留（驻留编号只在进程内有效）。
+// 头部记录格式版本、字节序、Token 的大小、源码的哈希和长度以及文件的大小，任何一项不符都视为未命中。
+// 命中时只检查头部，耗时与文件大小无关；头部之后全部内容的校验和在写入时计算，
+// 并且在临时文件改名为最终的文件名之前核对，只有完整、正确写入的文件才会被读者看到。
+class AstCache {
+   public:
+    // 文件格式或者语义分析的规则有任何变化时递增
+    static constexpr uint32_t VERSION = 6;
+
+    // directory 不存在时自动创建
+    explicit AstCache(std::string directory);
+
+    // 命中时返回指向缓存文件的 FlatAST，跳过词法、语法和语义分析
+    std::optional<FlatAST> load(const std::shared_ptr<const Source> &source) const;
+
+    // 先写入同一目录中的临时文件，再改名为最终的文件名。改名是原子的，
+    // 多个进程同时写同一个缓存时，读者只会看到某一个完整的文件。ast 必须已经通过 FlatSemanticAnalyzer 的检查；
+    // 失败时抛出 std::runtime_error
+    void store(const FlatAST &ast) const;
+
+    std::string path(const SourceHash &hash) const;
+
+   private:
+    std::string directory_;
+};
+
+#endif
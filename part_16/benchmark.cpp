@@ -0,0 +1,663 @@
+// 性能基准：benchmark [name ...]，不带参数时运行全部基准
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ast_cache.hpp"
+#include "compiler.hpp"
+#include "flat_ast.hpp"
+#include "flat_interpreter.hpp"
+#include "flat_semantic_analyzer.hpp"
+#include "interpreter.hpp"
+#include "keywords.hpp"
+#include "lexer.hpp"
+#include "parallel_lexer.hpp"
+#include "parser.hpp"
+#include "program.hpp"
+#include "semantic_analyzer.hpp"
+#include "simd_scan.hpp"
+#include "token_pipeline.hpp"
+#include "token_stream.hpp"
+#include "trace.hpp"
+#include "vm.hpp"
+
+// 统计堆分配次数
+static std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// 生成只含算术赋值语句的程序，每 4 条语句从常量重新计算，保证数值有界
+std::string arithmeticProgram(int rounds) {
+    std::string text = "program Bench;\nvar\n   a, b, c, d : integer;\n   y : real;\nbegin\n";
+    for (int i = 0; i < rounds; ++i) {
+        text += "   a := 1 + 2 * 3 - 4 div 2;\n";
+        text += "   b := a * 2 - (a + 3) div 2;\n";
+        text += "   c := -(a - b) + b * 3 div 4;\n";
+        text += "   y := (a + b) * (c - a) / 2;\n";
+    }
+    text += "   d := a + b + c\nend.\n";
+    return text;
+}
+
+// 对比树遍历解释器与字节码 VM 的执行耗时（不含词法、语法分析）
+void benchExecutionEngines() {
+    const int rounds = 20000;
+    const int iterations = 50;
+    auto parser = Parser(Lexer(arithmeticProgram(rounds)));
+    auto program = ParsedProgram::parse(parser);
+    auto root = program->root();
+
+    auto *saved = std::cout.rdbuf(nullptr);
+    // Interpreter 使用语义分析解析好的槽位
+    SemanticAnalyzer(program).check();
+    auto interpreter = std::make_shared<Interpreter>(program);
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        interpreter->interpret();
+    }
+    auto tree_seconds = secondsSince(start);
+
+    start = Clock::now();
+    VM vm(std::make_shared<BytecodeCompiler>()->compile(root));
+    auto compile_seconds = secondsSince(start);
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        vm.run();
+    }
+    auto vm_seconds = secondsSince(start);
+    std::cout.rdbuf(saved);
+
+    double statements = static_cast<double>(rounds) * 4 * iterations;
+    std::cout << "execution engines: " << rounds * 4 << " statements x " << iterations << " runs" << std::endl;
+    std::cout << "  tree walker : " << tree_seconds * 1e9 / statements << " ns/statement" << std::endl;
+    std::cout << "  bytecode vm : " << vm_seconds * 1e9 / statements << " ns/statement (compile "
+              << compile_seconds * 1e3 << " ms, " << vm.program().code_.size() << " instructions)" << std::endl;
+    std::cout << "  speedup     : " << tree_seconds / vm_seconds << "x" << std::endl;
+}
+
+// 与 arithmeticProgram 相同的语句，但带有大段注释和缩进，模拟生成代码
+std::string commentedProgram(int rounds) {
+    std::string text = "program Bench;\nvar\n   a, b, c, d : integer;\n   y : real;\nbegin\n";
+    for (int i = 0; i < rounds; ++i) {
+        text += "        { ---------------------------------------------------------------\n";
+        text += "          generated block, see the template for details about each step\n";
+        text += "          --------------------------------------------------------------- }\n";
+        text += "        a := 1 + 2 * 3 - 4 div 2;                { step 1 }\n";
+        text += "        b := a * 2 - (a + 3) div 2;              { step 2 }\n";
+        text += "                                                                 \n";
+        text += "        c := -(a - b) + b * 3 div 4;             { step 3 }\n";
+        text += "        y := (a + b) * (c - a) / 2;              { step 4 }\n";
+    }
+    text += "   d := a + b + c\nend.\n";
+    return text;
+}
+
+// 对整个源码做一遍词法分析，返回 token 数
+size_t lexAll(const std::shared_ptr<const Source> &source) {
+    auto lexer = Lexer(source);
+    size_t tokens = 0;
+    while (lexer.getNextToken().type_ != END_OF_FILE) {
+        ++tokens;
+    }
+    return tokens;
+}
+
+// 词法分析吞吐量（MB/s），对比标量与 SIMD 的空白、注释跳过，并统计词法分析过程中的堆分配次数
+void benchLexer() {
+    const int rounds = 200000;
+    const std::pair<const char *, std::string> inputs[] = {
+        {"plain", arithmeticProgram(rounds)},
+        {"commented", commentedProgram(rounds)},
+    };
+    auto best = std::string(scanImplementation());
+    for (const auto &[name, text] : inputs) {
+        auto source = std::make_shared<const Source>(text);
+        auto size = source->text().size();
+        std::cout << "lexer (" << name << "): " << size / 1024 << " KiB source" << std::endl;
+        for (const auto &implementation : {std::string("scalar"), best}) {
+            selectScanImplementation(implementation.c_str());
+            auto allocations_before = allocations.load();
+            auto start = Clock::now();
+            auto tokens = lexAll(source);
+            auto seconds = secondsSince(start);
+            auto allocated = allocations.load() - allocations_before;
+            std::cout << "  " << implementation << "\t: " << size / seconds / 1e6 << " MB/s, "
+                      << tokens / seconds / 1e6 << " Mtokens/s, " << allocated << " allocations" << std::endl;
+        }
+    }
+    selectScanImplementation("best");
+}
+
+// 关键字识别：完美哈希与转大写后查 unordered_map 的对比（每秒识别的标识符数）
+void benchKeywords() {
+    const int iterations = 2000000;
+    const std::vector<std::string> words = {
+        "BEGIN", "end", "Program", "var", "div", "integer", "REAL", "procedure", "a", "b",
+        "number", "x", "alpha", "Beta", "counter", "y", "total", "result", "i", "_tmp",
+    };
+    const std::unordered_map<std::string, TokenType> map = {
+        {"BEGIN", BEGIN},     {"END", END},         {"PROGRAM", PROGRAM}, {"VAR", VAR},
+        {"DIV", INTEGER_DIV}, {"INTEGER", INTEGER}, {"REAL", REAL},       {"PROCEDURE", PROCEDURE},
+    };
+    double count = static_cast<double>(iterations) * words.size();
+
+    size_t map_hits = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (const auto &word : words) {
+            auto upper = word;
+            for (auto &c : upper) {
+                c = foldCase(c);
+            }
+            map_hits += map.find(upper) != map.end();
+        }
+    }
+    auto map_seconds = secondsSince(start);
+
+    size_t hash_hits = 0;
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (const auto &word : words) {
+            TokenType type = ID;
+            hash_hits += keywords::lookup(word, type);
+        }
+    }
+    auto hash_seconds = secondsSince(start);
+
+    std::cout << "keywords: " << words.size() << " words, " << map_hits << "/" << hash_hits << " hits" << std::endl;
+    std::cout << "  unordered_map : " << count / map_seconds / 1e6 << " Mids/s" << std::endl;
+    std::cout << "  perfect hash  : " << count / hash_seconds / 1e6 << " Mids/s (" << map_seconds / hash_seconds
+              << "x)" << std::endl;
+}
+
+// 以数字字面量为主的程序
+std::string numericProgram(int rounds) {
+    std::string text = "program Numbers;\nvar\n   a : integer;\n   y : real;\nbegin\n";
+    for (int i = 0; i < rounds; ++i) {
+        auto n = std::to_string(i);
+        text += "   a := " + n + "1 + 40960 * " + n + " - 7;\n";
+        text += "   y := " + n + ".125 * 3.14159265 + 0." + n + "5 / 2.5;\n";
+    }
+    text += "   a := 0\nend.\n";
+    return text;
+}
+
+// 数字字面量转换：旧实现复制为 std::string 再调用 stoi/stof，新实现在源码上直接 from_chars
+void benchNumbers() {
+    const int rounds = 200000;
+    auto source = std::make_shared<const Source>(numericProgram(rounds));
+    auto text = source->text();
+    std::vector<Token> literals;
+    auto lexer = Lexer(source);
+    for (auto token = lexer.getNextToken(); token.type_ != END_OF_FILE; token = lexer.getNextToken()) {
+        if (token.type_ == INTEGER_CONST || token.type_ == REAL_CONST) {
+            literals.push_back(token);
+        }
+    }
+
+    double checksum = 0;
+    auto start = Clock::now();
+    for (const auto &token : literals) {
+        auto literal = std::string(token.text(text));
+        checksum += token.type_ == REAL_CONST ? std::stof(literal) : std::stoi(literal);
+    }
+    auto old_seconds = secondsSince(start);
+
+    start = Clock::now();
+    for (const auto &token : literals) {
+        auto literal = token.text(text);
+        auto last = literal.data() + literal.size();
+        std::from_chars_result result;
+        if (token.type_ == REAL_CONST) {
+            double value = 0;
+            result = std::from_chars(literal.data(), last, value);
+            checksum += value;
+        } else {
+            int64_t value = 0;
+            result = std::from_chars(literal.data(), last, value);
+            checksum += static_cast<double>(value);
+        }
+        if (result.ec != std::errc() || result.ptr != last) {
+            throw std::runtime_error("numeric literal out of range: " + std::string(literal));
+        }
+    }
+    auto new_seconds = secondsSince(start);
+
+    start = Clock::now();
+    auto tokens = lexAll(source);
+    auto lex_seconds = secondsSince(start);
+
+    double count = static_cast<double>(literals.size());
+    std::cout << "numbers: " << literals.size() << " literals (checksum " << checksum << ")" << std::endl;
+    std::cout << "  string + stoi/stof : " << count / old_seconds / 1e6 << " Mliterals/s" << std::endl;
+    std::cout << "  from_chars         : " << count / new_seconds / 1e6 << " Mliterals/s (" << old_seconds / new_seconds
+              << "x)" << std::endl;
+    std::cout << "  lexer              : " << text.size() / lex_seconds / 1e6 << " MB/s, " << tokens / lex_seconds / 1e6
+              << " Mtokens/s" << std::endl;
+}
+
+// 并行词法分析在不同线程数下的吞吐量
+void benchParallelLexer() {
+    const int rounds = 400000;
+    auto source = std::make_shared<const Source>(commentedProgram(rounds));
+    auto size = source->text().size();
+    // 与并行版本一样把 token 收集到数组中
+    auto start = Clock::now();
+    std::vector<Token> tokens;
+    auto lexer = Lexer(source);
+    do {
+        tokens.push_back(lexer.getNextToken());
+    } while (tokens.back().type_ != END_OF_FILE);
+    auto sequential = secondsSince(start);
+    std::cout << "parallel lexer: " << size / 1024 / 1024 << " MiB source, " << tokens.size() << " tokens, "
+              << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    std::cout << "  sequential : " << size / sequential / 1e6 << " MB/s" << std::endl;
+    for (unsigned threads : {1u, 2u, 4u, 8u, 16u}) {
+        start = Clock::now();
+        auto result = lexParallel(source, threads);
+        auto seconds = secondsSince(start);
+        std::cout << "  " << threads << " threads\t: " << size / seconds / 1e6 << " MB/s (" << sequential / seconds
+                  << "x)" << std::endl;
+    }
+}
+
+// 词法 + 语法分析耗时，以及 AST 占用的 Arena 内存
+void benchParse() {
+    const int rounds = 100000;
+    auto text = arithmeticProgram(rounds);
+    auto start = Clock::now();
+    auto parser = Parser(Lexer(text));
+    parser.parse();
+    auto seconds = secondsSince(start);
+    std::cout << "parse: " << text.size() / 1024 << " KiB source, " << rounds * 4 << " statements" << std::endl;
+    std::cout << "  time  : " << seconds * 1e3 << " ms (" << text.size() / seconds / 1e6 << " MB/s)" << std::endl;
+    std::cout << "  arena : " << parser.arena()->reserved() / 1024 << " KiB" << std::endl;
+
+    // 先分析成 TokenStream，再按下标做语法分析
+    auto source = std::make_shared<const Source>(text);
+    start = Clock::now();
+    auto tokens = TokenStream::lex(source);
+    auto lex_seconds = secondsSince(start);
+    start = Clock::now();
+    Parser(tokens).parse();
+    auto parse_seconds = secondsSince(start);
+    std::cout << "  pre-lexed : lex " << lex_seconds * 1e3 << " ms + parse " << parse_seconds * 1e3 << " ms ("
+              << tokens->size() << " tokens, parse " << seconds / parse_seconds << "x faster than lex+parse)"
+              << std::endl;
+
+    // Lexer 在另一个线程上同时分析
+    start = Clock::now();
+    auto pipeline = std::make_shared<TokenPipeline>(source);
+    Parser(pipeline).parse();
+    auto pipeline_seconds = secondsSince(start);
+    auto stats = pipeline->stats();
+    std::cout << "  pipelined : " << pipeline_seconds * 1e3 << " ms (" << seconds / pipeline_seconds
+              << "x), lexer busy " << stats.lex_seconds_ * 1e3 << " ms, parser starved "
+              << stats.consumer_wait_seconds_ * 1e3 << " ms, " << std::thread::hardware_concurrency()
+              << " hardware threads" << std::endl;
+}
+
+// 一条很长的赋值语句：operands 个操作数，依次使用各种优先级的运算符
+std::string longExpressionProgram(int operands) {
+    static const char *OPS[] = {" + ", " * ", " - ", " div ", " / "};
+    std::string text = "program Long;\nvar\n   a : integer;\n   y : real;\nbegin\n   y := a";
+    for (int i = 1; i < operands; ++i) {
+        text += OPS[i % 5];
+        text += i % 3 == 0 ? "(a + 1)" : "a";
+    }
+    text += "\nend.\n";
+    return text;
+}
+
+// 括号嵌套 depth 层的表达式，每层带一个一元运算符和一个二元运算符
+std::string nestedExpressionProgram(int depth) {
+    std::string text = "program Nested;\nvar\n   a : integer;\nbegin\n   a := ";
+    for (int i = 0; i < depth; ++i) {
+        text += "-(a * ";
+    }
+    text += "a";
+    for (int i = 0; i < depth; ++i) {
+        text += ")";
+    }
+    text += "\nend.\n";
+    return text;
+}
+
+// 表达式的语法分析：很长的表达式以及深度嵌套的表达式（预先分析 token，只计语法分析）
+void benchExpressions() {
+    auto run = [](const char *name, const std::string &text, int operands) {
+        auto tokens = TokenStream::lex(std::make_shared<const Source>(text));
+        const int iterations = 5;
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            Parser(tokens).parse();
+        }
+        auto seconds = secondsSince(start) / iterations;
+        std::cout << "  " << name << " : " << operands << " operands, " << seconds * 1e3 << " ms ("
+                  << operands / seconds / 1e6 << " Moperands/s)" << std::endl;
+    };
+    std::cout << "expressions:" << std::endl;
+    run("long  ", longExpressionProgram(1000000), 1000000);
+    run("nested", nestedExpressionProgram(300000), 300000 + 1);
+}
+
+// procedures 个过程，每个过程都有局部变量、一个嵌套过程和若干语句，主程序只调用其中一个
+std::string proceduresProgram(int procedures) {
+    std::string text = "program Procs;\nvar\n   a : integer;\n";
+    for (int i = 0; i < procedures; ++i) {
+        auto name = "P" + std::to_string(i);
+        text += "procedure " + name + "(x : integer; y : real);\nvar\n   b, c : integer;\n";
+        text += "   procedure " + name + "Inner;\n   begin\n      c := c * 2\n   end;\n";
+        text += "begin\n";
+        text += "   b := x * 2 + 1;\n   c := (b - x) div 3;\n";
+        text += "   begin\n      y := y / 2 + b * c - 1\n   end;\n";
+        text += "   " + name + "Inner()\nend;\n";
+    }
+    text += "begin\n   a := 1;\n   P0(a, 2.5)\nend.\n";
+    return text;
+}
+
+// depth 层嵌套的过程，每层声明一个局部变量；最内层的语句引用各层的变量，查找要沿作用域链向外走
+std::string nestedProceduresProgram(int depth, int statements) {
+    std::string text = "program Nested;\nvar\n   v0 : integer;\n";
+    for (int i = 1; i <= depth; ++i) {
+        text += "procedure P" + std::to_string(i) + ";\nvar\n   v" + std::to_string(i) + " : real;\n";
+    }
+    text += "begin\n";
+    for (int i = 0; i < statements; ++i) {
+        auto level = std::to_string(i % (depth + 1));
+        text += "   v" + std::to_string(depth) + " := v0 + v" + level + " * 2;\n";
+    }
+    text += "   v0 := v0\nend;\n";
+    for (int i = depth - 1; i >= 1; --i) {
+        text += "begin\n   v" + std::to_string(i) + " := v0\nend;\n";
+    }
+    text += "begin\n   v0 := 1\nend.\n";
+    return text;
+}
+
+// 语义分析深层嵌套的过程：建立各层作用域以及沿作用域链查找名字的耗时（不含语法分析）
+void benchNestedScopes() {
+    const int depth = 200;
+    const int statements = 20000;
+    const int iterations = 10;
+    auto parser = Parser(Lexer(nestedProceduresProgram(depth, statements)));
+    auto program = ParsedProgram::parse(parser);
+    auto *saved = std::cout.rdbuf(nullptr);
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        SemanticAnalyzer(program).check();
+    }
+    auto seconds = secondsSince(start) / iterations;
+    std::cout.rdbuf(saved);
+    // 每条语句查找 3 个名字
+    double lookups = static_cast<double>(statements) * 3;
+    std::cout << "nested scopes: " << depth << " levels, " << statements << " statements in the innermost body"
+              << std::endl;
+    std::cout << "  semantic analysis : " << seconds * 1e3 << " ms (" << seconds * 1e9 / lookups << " ns/lookup)"
+              << std::endl;
+}
+
+// 语义分析的跟踪：关闭时只有一次原子读，开启时记录由后台线程写出（这里写到 /dev/null）
+void benchTrace() {
+    const int procedures = 5000;
+    const int iterations = 5;
+    auto parser = Parser(Lexer(proceduresProgram(procedures)));
+    auto program = ParsedProgram::parse(parser);
+    auto run = [&] {
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            SemanticAnalyzer(program).check();
+        }
+        return secondsSince(start) / iterations;
+    };
+    auto disabled = run();
+    auto *sink = std::fopen("/dev/null", "w");
+    if (sink == nullptr) {
+        return;
+    }
+    trace::enable(TRACE_SEMANTIC, TRACE_DEBUG, sink);
+    auto start = Clock::now();
+    auto enabled = run();
+    // 包括等待后台线程写完
+    trace::flush();
+    auto drained = secondsSince(start) / iterations;
+    trace::disable(TRACE_SEMANTIC);
+    std::fclose(sink);
+    std::cout << "trace: semantic analysis of " << procedures << " procedures" << std::endl;
+    std::cout << "  disabled           : " << disabled * 1e3 << " ms" << std::endl;
+    std::cout << "  semantic:debug     : " << enabled * 1e3 << " ms (" << drained * 1e3 << " ms until written)"
+              << std::endl;
+}
+
+// 惰性分析过程体：只扫描过程体的耗时，以及用到一个、全部过程体时的耗时
+void benchLazyBodies() {
+    const int procedures = 20000;
+    const int iterations = 5;
+    auto source = std::make_shared<const Source>(proceduresProgram(procedures));
+    auto run = [&](bool lazy, int forced) {
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            auto parser = Parser(Lexer(source));
+            parser.setLazyBodies(lazy);
+            auto program = ParsedProgram::parse(parser);
+            auto &declarations = program->root()->block_->declarations_;
+            // 第一个声明是变量 a，其后是各个过程
+            for (int j = 0; j < forced; ++j) {
+                program->body(static_cast<ProcedureDecl *>(declarations[j + 1]));
+            }
+        }
+        return secondsSince(start) / iterations;
+    };
+    auto eager = run(false, 0);
+    auto scan = run(true, 0);
+    auto first = run(true, 1);
+    auto all = run(true, procedures);
+    std::cout << "lazy bodies: " << source->text().size() / 1024 << " KiB source, " << procedures << " procedures"
+              << std::endl;
+    std::cout << "  eager parse        : " << eager * 1e3 << " ms" << std::endl;
+    std::cout << "  lazy, no bodies    : " << scan * 1e3 << " ms (" << eager / scan << "x)" << std::endl;
+    std::cout << "  lazy, one body     : " << first * 1e3 << " ms" << std::endl;
+    std::cout << "  lazy, all bodies   : " << all * 1e3 << " ms" << std::endl;
+}
+
+// 并行建立各个过程体，与顺序分析对比
+void benchParallelParse() {
+    const int procedures = 20000;
+    const int iterations = 5;
+    auto source = std::make_shared<const Source>(proceduresProgram(procedures));
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        auto parser = Parser(Lexer(source));
+        ParsedProgram::parse(parser);
+    }
+    auto sequential = secondsSince(start) / iterations;
+    std::cout << "parallel parse: " << procedures << " procedures, " << std::thread::hardware_concurrency()
+              << " hardware threads" << std::endl;
+    std::cout << "  sequential : " << sequential * 1e3 << " ms" << std::endl;
+    for (unsigned threads : {1u, 2u, 4u, 8u}) {
+        start = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            auto parser = Parser(Lexer(source));
+            ParsedProgram::parseParallel(parser, threads);
+        }
+        auto seconds = secondsSince(start) / iterations;
+        std::cout << "  " << threads << " threads\t: " << seconds * 1e3 << " ms (" << sequential / seconds << "x)"
+                  << std::endl;
+    }
+}
+
+// 并行检查各个过程体，与顺序检查对比（不含语法分析）
+void benchParallelCheck() {
+    const int procedures = 20000;
+    const int iterations = 5;
+    auto parser = Parser(Lexer(proceduresProgram(procedures)));
+    auto program = ParsedProgram::parse(parser);
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        SemanticAnalyzer(program).check();
+    }
+    auto sequential = secondsSince(start) / iterations;
+    std::cout << "parallel check: " << procedures << " procedures, " << std::thread::hardware_concurrency()
+              << " hardware threads" << std::endl;
+    std::cout << "  sequential : " << sequential * 1e3 << " ms" << std::endl;
+    for (unsigned threads : {1u, 2u, 4u, 8u}) {
+        start = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            SemanticAnalyzer(program).checkParallel(threads);
+        }
+        auto seconds = secondsSince(start) / iterations;
+        std::cout << "  " << threads << " threads\t: " << seconds * 1e3 << " ms (" << sequential / seconds << "x)"
+                  << std::endl;
+    }
+}
+
+// 指针 AST 与扁平 AST 上语义分析、解释执行的吞吐量
+void benchFlatAST() {
+    const int rounds = 100000;
+    const int iterations = 5;
+    auto parser = Parser(Lexer(arithmeticProgram(rounds)));
+    auto program = ParsedProgram::parse(parser);
+    auto start = Clock::now();
+    auto ast = flatten(*program);
+    auto flatten_seconds = secondsSince(start);
+
+    auto *saved = std::cout.rdbuf(nullptr);
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        SemanticAnalyzer(program).check();
+    }
+    auto tree_analyze = secondsSince(start);
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        FlatSemanticAnalyzer(ast).check();
+    }
+    auto flat_analyze = secondsSince(start);
+
+    auto interpreter = std::make_shared<Interpreter>(program);
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        interpreter->interpret();
+    }
+    auto tree_interpret = secondsSince(start);
+    FlatInterpreter flat_interpreter(ast);
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        flat_interpreter.interpret();
+    }
+    auto flat_interpret = secondsSince(start);
+    std::cout.rdbuf(saved);
+
+    double nodes = static_cast<double>(ast.size()) * iterations;
+    std::cout << "flat ast: " << ast.size() << " nodes (flatten " << flatten_seconds * 1e3 << " ms)" << std::endl;
+    std::cout << "  analyze   tree: " << nodes / tree_analyze / 1e6 << " Mnodes/s, flat: " << nodes / flat_analyze / 1e6
+              << " Mnodes/s (" << tree_analyze / flat_analyze << "x)" << std::endl;
+    std::cout << "  interpret tree: " << nodes / tree_interpret / 1e6 << " Mnodes/s, flat: "
+              << nodes / flat_interpret / 1e6 << " Mnodes/s (" << tree_interpret / flat_interpret << "x)" << std::endl;
+}
+
+// 从源码到可执行的扁平 AST：完整的前端与命中缓存的对比
+void benchAstCache() {
+    const int rounds = 100000;
+    const int iterations = 5;
+    auto source = std::make_shared<const Source>(arithmeticProgram(rounds));
+    auto directory = (std::filesystem::temp_directory_path() / "pascal-benchmark-cache").string();
+    AstCache cache(directory);
+
+    auto *saved = std::cout.rdbuf(nullptr);
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        auto parser = Parser(Lexer(source));
+        auto ast = flatten(*ParsedProgram::parse(parser));
+        FlatSemanticAnalyzer(ast).check();
+    }
+    auto front_end = secondsSince(start) / iterations;
+    std::cout.rdbuf(saved);
+
+    auto parser = Parser(Lexer(source));
+    auto ast = flatten(*ParsedProgram::parse(parser));
+    FlatSemanticAnalyzer(ast).check();
+    start = Clock::now();
+    cache.store(ast);
+    auto store = secondsSince(start);
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        cache.load(source);
+    }
+    auto load = secondsSince(start) / iterations;
+    start = Clock::now();
+    hashSource(source->text());
+    auto hash = secondsSince(start);
+    std::filesystem::remove_all(directory);
+
+    std::cout << "ast cache: " << source->text().size() / 1024 << " KiB source, " << ast.size() << " nodes" << std::endl;
+    std::cout << "  lex+parse+analyze : " << front_end * 1e3 << " ms" << std::endl;
+    std::cout << "  store             : " << store * 1e3 << " ms" << std::endl;
+    std::cout << "  hit               : " << load * 1e3 << " ms (hash " << hash * 1e3 << " ms, "
+              << front_end / load << "x)" << std::endl;
+}
+
+const std::vector<std::pair<std::string, std::function<void()>>> benchmarks = {
+    {"lexer", benchLexer},
+    {"keywords", benchKeywords},
+    {"numbers", benchNumbers},
+    {"parallel-lexer", benchParallelLexer},
+    {"parse", benchParse},
+    {"expressions", benchExpressions},
+    {"lazy", benchLazyBodies},
+    {"parallel-parse", benchParallelParse},
+    {"parallel-check", benchParallelCheck},
+    {"engines", benchExecutionEngines},
+    {"scopes", benchNestedScopes},
+    {"trace", benchTrace},
+    {"flat", benchFlatAST},
+    {"cache", benchAstCache},
+};
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    for (const auto &[name, bench] : benchmarks) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++i) {
+            selected = selected || name == argv[i];
+        }
+        if (selected) {
+            bench();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "bytecode.hpp"
+
+std::ostream &operator<<(std::ostream &out, const OpCode &op) {
+    switch (op) {
+        case OP_LOADK:
+            out << "LOADK";
+            break;
+        case OP_MOVE:
+            out << "MOVE";
+            break;
+        case OP_ADD:
+            out << "ADD";
+            break;
+        case OP_SUB:
+            out << "SUB";
+            break;
+        case OP_MUL:
+            out << "MUL";
+            break;
+        case OP_IDIV:
+            out << "IDIV";
+            break;
+        case OP_FDIV:
+            out << "FDIV";
+            break;
+        case OP_NEG:
+            out << "NEG";
+            break;
+        case OP_HALT:
+            out << "HALT";
+            break;
+        case OP_LOADI:
+            out << "LOADI";
+            break;
+        case OP_IADD:
+            out << "IADD";
+            break;
+        case OP_ISUB:
+            out << "ISUB";
+            break;
+        case OP_IMUL:
+            out << "IMUL";
+            break;
+        case OP_INEG:
+            out << "INEG";
+            break;
+        case OP_ITOF:
+            out << "ITOF";
+            break;
+        case OP_SPILL:
+            out << "SPILL";
+            break;
+        case OP_RELOAD:
+            out << "RELOAD";
+            break;
+        default:
+            break;
+    }
+    return out;
+}
+
+std::ostream &operator<<(std::ostream &out, const BytecodeProgram &program) {
+    out << "BYTECODE (" << program.name_ << ")\n";
+    out << "===========================" << std::endl;
+    out << "registers: " << program.register_count_
+        << ", constants: " << program.constants_.size() + program.integer_constants_.size();
+    if (program.spill_count_ != 0) {
+        out << ", spill slots: " << program.spill_count_;
+    }
+    out << std::endl;
+    for (size_t i = 0; i < program.variables_.size(); ++i) {
+        out << "  R" << i << " = " << identifiers().name(program.variables_[i]) << " : " << program.variable_types_[i]
+            << std::endl;
+    }
+    out << "-----------------------------------" << std::endl;
+    for (size_t pc = 0; pc < program.code_.size(); ++pc) {
+        const auto &inst = program.code_[pc];
+        out << pc << "\t" << inst.op_;
+        switch (inst.op_) {
+            case OP_LOADK:
+                out << "\tR" << inst.a_ << ", K" << inst.bx() << " (" << program.constants_[inst.bx()] << ")";
+                break;
+            case OP_LOADI:
+                out << "\tR" << inst.a_ << ", I" << inst.bx() << " (" << program.integer_constants_[inst.bx()] << ")";
+                break;
+            case OP_MOVE:
+            case OP_NEG:
+            case OP_INEG:
+            case OP_ITOF:
+                out << "\tR" << inst.a_ << ", R" << inst.b_;
+                break;
+            case OP_SPILL:
+                out << "\tS" << inst.bx() << ", R" << inst.a_;
+                break;
+            case OP_RELOAD:
+                out << "\tR" << inst.a_ << ", S" << inst.bx();
+                break;
+            case OP_HALT:
+                break;
+            default:
+                out << "\tR" << inst.a_ << ", R" << inst.b_ << ", R" << inst.c_;
+                break;
+        }
+        out << std::endl;
+    }
+    return out;
+}
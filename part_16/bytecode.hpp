@@ -0,0 +1,74 @@
+#ifndef BYTECODE_HPP_
+#define BYTECODE_HPP_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "identifier.hpp"
+#include "value.hpp"
+
+// 基于寄存器的字节码。每条指令 8 字节，a 为目标寄存器，b、c 为源寄存器。
+// LOADK、LOADI 的常量下标以及 SPILL、RELOAD 的溢出区下标由 b、c 拼成 32 位（bx）。
+// 寄存器不带类型标记：编译器按语义分析推导出的静态类型选择整数或者实数指令，
+// INTEGER 的值参与实数运算之前用 ITOF 显式转换
+enum OpCode : uint8_t {
+    OP_LOADK,   // R[a] = K[bx]（REAL）
+    OP_MOVE,    // R[a] = R[b]
+    OP_ADD,     // R[a] = R[b] + R[c]（REAL）
+    OP_SUB,     // R[a] = R[b] - R[c]（REAL）
+    OP_MUL,     // R[a] = R[b] * R[c]（REAL）
+    OP_IDIV,    // R[a] = R[b] div R[c]（INTEGER）
+    OP_FDIV,    // R[a] = R[b] / R[c]（REAL）
+    OP_NEG,     // R[a] = -R[b]（REAL）
+    OP_HALT,    // 结束执行
+    OP_LOADI,   // R[a] = I[bx]（INTEGER）
+    OP_IADD,    // R[a] = R[b] + R[c]（INTEGER）
+    OP_ISUB,    // R[a] = R[b] - R[c]（INTEGER）
+    OP_IMUL,    // R[a] = R[b] * R[c]（INTEGER）
+    OP_INEG,    // R[a] = -R[b]（INTEGER）
+    OP_ITOF,    // R[a] = REAL(R[b])
+    OP_SPILL,   // S[bx] = R[a]
+    OP_RELOAD,  // R[a] = S[bx]
+};
+
+std::ostream &operator<<(std::ostream &out, const OpCode &op);
+
+struct Instruction {
+    OpCode op_;
+    uint8_t unused_ = 0;
+    uint16_t a_ = 0;
+    uint16_t b_ = 0;
+    uint16_t c_ = 0;
+
+    Instruction(OpCode op, uint16_t a = 0, uint16_t b = 0, uint16_t c = 0) : op_(op), a_(a), b_(b), c_(c) {}
+
+    static Instruction ABx(OpCode op, uint16_t a, uint32_t bx) {
+        return Instruction(op, a, static_cast<uint16_t>(bx & 0xffff), static_cast<uint16_t>(bx >> 16));
+    }
+
+    uint32_t bx() const { return static_cast<uint32_t>(b_) | (static_cast<uint32_t>(c_) << 16); }
+};
+
+static_assert(sizeof(Instruction) == 8, "Instruction should stay compact");
+
+// 编译结果：指令序列、常量池以及寄存器布局。
+// 寄存器 [0, variables_.size()) 按声明顺序固定分配给变量，其后为临时寄存器；variable_types_ 为各变量的类型。
+// assigned_ 按首次赋值的顺序记录被赋值过的变量寄存器，用于输出全局作用域。
+// 表达式嵌套过深、临时寄存器不够用时，等待中的操作数暂存在溢出区 S 中，spill_count_ 为其大小。
+struct BytecodeProgram {
+    std::string name_;
+    std::vector<Instruction> code_;
+    std::vector<double> constants_;
+    std::vector<int64_t> integer_constants_;
+    std::vector<Identifier> variables_;
+    std::vector<ValueType> variable_types_;
+    std::vector<uint32_t> assigned_;
+    uint32_t register_count_ = 0;
+    uint32_t spill_count_ = 0;
+};
+
+std::ostream &operator<<(std::ostream &out, const BytecodeProgram &program);
+
+#endif
@@ -0,0 +1,282 @@
+#include "compiler.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// 寄存器编号在指令中只有 16 位，变量与临时寄存器合计不能超过 65536 个
+std::runtime_error tooManyRegisters() {
+    return std::runtime_error("too many registers: expression or variable count exceeds " +
+                              std::to_string(UINT16_MAX + 1));
+}
+
+}  // namespace
+
+BytecodeProgram BytecodeCompiler::compile(ASTNode *root) {
+    program_ = BytecodeProgram();
+    registers_.clear();
+    assigned_.clear();
+    constant_index_.clear();
+    integer_constant_index_.clear();
+    next_temp_ = 0;
+    next_spill_ = 0;
+    root->visit(this);
+    emit(OP_HALT, 0);
+    return std::move(program_);
+}
+
+uint32_t BytecodeCompiler::compileExpr(ASTNode *node, uint32_t target) {
+    expr_root_ = node;
+    target_ = target;
+    spilled_ = 0;
+    walker_.walk(node, this);
+    load(results_.size() - 1, target);
+    auto result = results_.back().reg_;
+    results_.pop_back();
+    return result;
+}
+
+uint32_t BytecodeCompiler::destination(ASTNode *node) {
+    return node == expr_root_ && target_ != NO_REGISTER ? target_ : allocTemp();
+}
+
+uint32_t BytecodeCompiler::popOperand() {
+    auto reg = results_.back().reg_;
+    results_.pop_back();
+    spilled_ = std::min(spilled_, results_.size());
+    // 操作数按后序求值，占用的临时寄存器一定位于栈顶，用完即可复用。
+    // 运算符的两个操作数一起取出，先取出的右操作数可能位于左操作数之下，一并归还
+    if (reg >= program_.variables_.size() && reg < next_temp_) {
+        next_temp_ = reg;
+    }
+    return reg;
+}
+
+void BytecodeCompiler::load(size_t index, uint32_t dst) {
+    if (results_[index].reg_ != NO_REGISTER) {
+        return;
+    }
+    if (dst == NO_REGISTER) {
+        dst = allocTemp();
+    }
+    auto &operand = results_[index];
+    program_.code_.push_back(Instruction::ABx(operand.load_, static_cast<uint16_t>(dst), operand.index_));
+    operand.reg_ = dst;
+    if (operand.load_ == OP_RELOAD) {
+        next_spill_ = operand.index_;
+    }
+}
+
+void BytecodeCompiler::spill() {
+    if (next_temp_ < spill_limit_) {
+        return;
+    }
+    auto base = static_cast<uint32_t>(program_.variables_.size());
+    for (auto i = spilled_; i + 1 < results_.size(); ++i) {
+        auto &operand = results_[i];
+        if (operand.reg_ == NO_REGISTER || operand.reg_ < base) {
+            continue;
+        }
+        auto slot = next_spill_++;
+        program_.code_.push_back(Instruction::ABx(OP_SPILL, static_cast<uint16_t>(operand.reg_), slot));
+        operand = Operand{NO_REGISTER, OP_RELOAD, slot};
+    }
+    spilled_ = results_.size() - 1;
+    program_.spill_count_ = std::max(program_.spill_count_, next_spill_);
+    auto &top = results_.back();
+    next_temp_ = base;
+    if (top.reg_ != NO_REGISTER && top.reg_ >= base) {
+        if (top.reg_ != base) {
+            emit(OP_MOVE, base, top.reg_);
+        }
+        top.reg_ = allocTemp();
+    }
+}
+
+uint32_t BytecodeCompiler::allocTemp() {
+    auto reg = next_temp_++;
+    if (reg > UINT16_MAX) {
+        throw tooManyRegisters();
+    }
+    if (next_temp_ > program_.register_count_) {
+        program_.register_count_ = next_temp_;
+    }
+    return reg;
+}
+
+uint32_t BytecodeCompiler::constant(double value) {
+    auto it = constant_index_.find(value);
+    if (it != constant_index_.end()) {
+        return it->second;
+    }
+    auto index = static_cast<uint32_t>(program_.constants_.size());
+    program_.constants_.push_back(value);
+    constant_index_.emplace(value, index);
+    return index;
+}
+
+uint32_t BytecodeCompiler::integerConstant(int64_t value) {
+    auto it = integer_constant_index_.find(value);
+    if (it != integer_constant_index_.end()) {
+        return it->second;
+    }
+    auto index = static_cast<uint32_t>(program_.integer_constants_.size());
+    program_.integer_constants_.push_back(value);
+    integer_constant_index_.emplace(value, index);
+    return index;
+}
+
+void BytecodeCompiler::promote(size_t index) {
+    // 暂存在溢出区中的操作数先装入寄存器，再原地转换
+    if (results_[index].load_ == OP_RELOAD) {
+        load(index);
+    }
+    auto reg = results_[index].reg_;
+    if (reg == NO_REGISTER) {
+        // 还没有装入的整数常量直接改为实数常量
+        auto value = static_cast<double>(program_.integer_constants_[results_[index].index_]);
+        results_[index].load_ = OP_LOADK;
+        results_[index].index_ = constant(value);
+    } else if (reg >= program_.variables_.size()) {
+        emit(OP_ITOF, reg, reg);
+    } else {
+        auto temp = allocTemp();
+        emit(OP_ITOF, temp, reg);
+        results_[index].reg_ = temp;
+    }
+}
+
+void BytecodeCompiler::emit(OpCode op, uint32_t a, uint32_t b, uint32_t c) {
+    program_.code_.emplace_back(op, static_cast<uint16_t>(a), static_cast<uint16_t>(b), static_cast<uint16_t>(c));
+}
+
+void BytecodeCompiler::visit(ProgramNode *node) {
+    program_.name_ = std::string(identifiers().name(node->name_));
+    node->block_->visit(this);
+}
+
+void BytecodeCompiler::visit(BlockNode *node) {
+    for (auto &&declaration : node->declarations_) {
+        declaration->visit(this);
+    }
+    // 变量寄存器分配完毕，临时寄存器紧随其后
+    next_temp_ = static_cast<uint32_t>(program_.variables_.size());
+    program_.register_count_ = next_temp_;
+    // 两次 spill 之间一个运算符节点最多再用几个临时寄存器（提升、装入操作数以及结果），留出余量
+    spill_limit_ = std::min(next_temp_ + SPILL_THRESHOLD, static_cast<uint32_t>(UINT16_MAX + 1) - 8);
+    node->compound_statement_->visit(this);
+}
+
+void BytecodeCompiler::visit(VarDeclNode *node) {
+    auto var_name = node->var_node_->id_;
+    if (registers_.find(var_name) != registers_.end()) {
+        return;
+    }
+    // 变量同样占用寄存器
+    if (program_.variables_.size() > UINT16_MAX) {
+        throw tooManyRegisters();
+    }
+    registers_.emplace(var_name, static_cast<uint32_t>(program_.variables_.size()));
+    program_.variables_.emplace_back(var_name);
+    program_.variable_types_.emplace_back(node->var_node_->type_);
+}
+
+void BytecodeCompiler::visit(TypeNode *node) {}
+
+// 表达式节点由 compileExpr 按后序访问：操作数已经在 results_ 栈顶
+void BytecodeCompiler::visit(BinaryOpNode *node) {
+    auto integer = node->type_ == TYPE_INTEGER;
+    if (!integer) {
+        if (typeOf(node->right_) == TYPE_INTEGER) {
+            promote(results_.size() - 1);
+        }
+        if (typeOf(node->left_) == TYPE_INTEGER) {
+            promote(results_.size() - 2);
+        }
+    }
+    // 右操作数后入栈，暂存在溢出区中时位于左操作数之上，先装入
+    load(results_.size() - 1);
+    load(results_.size() - 2);
+    auto right = popOperand();
+    auto left = popOperand();
+    auto dst = destination(node);
+    if (node->op_.type_ == PLUS) {
+        emit(integer ? OP_IADD : OP_ADD, dst, left, right);
+    } else if (node->op_.type_ == MINUS) {
+        emit(integer ? OP_ISUB : OP_SUB, dst, left, right);
+    } else if (node->op_.type_ == MUL) {
+        emit(integer ? OP_IMUL : OP_MUL, dst, left, right);
+    } else if (node->op_.type_ == INTEGER_DIV) {
+        emit(OP_IDIV, dst, left, right);
+    } else if (node->op_.type_ == FLOAT_DIV) {
+        emit(OP_FDIV, dst, left, right);
+    }
+    results_.push_back(Operand{dst});
+    spill();
+}
+
+void BytecodeCompiler::visit(NumNode *node) {
+    // 等到运算符使用时再装入寄存器
+    if (node->isReal()) {
+        results_.push_back(Operand{NO_REGISTER, OP_LOADK, constant(node->real())});
+    } else {
+        results_.push_back(Operand{NO_REGISTER, OP_LOADI, integerConstant(node->integer())});
+    }
+}
+
+void BytecodeCompiler::visit(UnaryOpNode *node) {
+    if (node->token_.type_ == PLUS) {
+        // 值不变，仍在操作数所在的寄存器中
+        return;
+    }
+    load(results_.size() - 1);
+    auto value = popOperand();
+    auto dst = destination(node);
+    emit(node->type_ == TYPE_INTEGER ? OP_INEG : OP_NEG, dst, value);
+    results_.push_back(Operand{dst});
+    spill();
+}
+
+void BytecodeCompiler::visit(CompoundNode *node) {
+    for (const auto &child : node->children_) {
+        child->visit(this);
+    }
+}
+
+void BytecodeCompiler::visit(AssignNode *node) {
+    auto identifier = node->left_;
+    auto it = registers_.find(identifier);
+    if (it == registers_.end()) {
+        throw std::runtime_error("identifier " + std::string(identifiers().name(identifier)) + " not declare");
+    }
+    auto reg = it->second;
+    auto value = compileExpr(node->right_, reg);
+    if (node->type_ == TYPE_REAL && typeOf(node->right_) == TYPE_INTEGER) {
+        emit(OP_ITOF, reg, value);
+    } else if (value != reg) {
+        emit(OP_MOVE, reg, value);
+    }
+    if (assigned_.insert(reg).second) {
+        program_.assigned_.push_back(reg);
+    }
+}
+
+void BytecodeCompiler::visit(VarNode *node) {
+    auto identifier = node->id_;
+    auto it = registers_.find(identifier);
+    // 程序只有顺序执行的语句，读取未赋值的变量可以在编译期发现
+    if (it == registers_.end() || assigned_.find(it->second) == assigned_.end()) {
+        throw std::runtime_error("variable " + std::string(identifiers().name(identifier)) + " is not defined");
+    }
+    // 直接使用变量所在的寄存器，需要时由赋值语句复制到目标寄存器
+    results_.push_back(Operand{it->second});
+}
+
+void BytecodeCompiler::visit(ProcedureDecl *node) {}
+
+void BytecodeCompiler::visit(ProcedureCallNode *node) {}
+
+void BytecodeCompiler::visit(NoOpNode *node) {}
+
+void BytecodeCompiler::visit(ParamNode *node) {}
@@ -0,0 +1,109 @@
+#ifndef COMPILER_HPP_
+#define COMPILER_HPP_
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ast.hpp"
+#include "bytecode.hpp"
+#include "expression_walker.hpp"
+#include "identifier.hpp"
+
+// 把 AST 编译为基于寄存器的字节码，供 VM 执行。AST 必须先通过语义分析，按节点上的静态类型选择整数或者实数指令。
+// 执行语义与 Interpreter 保持一致：只执行全局作用域的语句，过程声明与过程调用暂不执行。
+class BytecodeCompiler : public Visitor {
+   public:
+    BytecodeProgram compile(ASTNode *root);
+
+    void visit(ProgramNode *node) override;
+
+    void visit(BlockNode *node) override;
+
+    void visit(VarDeclNode *node) override;
+
+    void visit(TypeNode *node) override;
+
+    void visit(BinaryOpNode *node) override;
+
+    void visit(NumNode *node) override;
+
+    void visit(UnaryOpNode *node) override;
+
+    void visit(CompoundNode *node) override;
+
+    void visit(AssignNode *node) override;
+
+    void visit(VarNode *node) override;
+
+    void visit(ProcedureDecl *node) override;
+
+    void visit(ProcedureCallNode *node) override;
+
+    void visit(NoOpNode *node) override;
+
+    void visit(ParamNode *node) override;
+
+   private:
+    static constexpr uint32_t NO_REGISTER = UINT32_MAX;
+
+    // 同时使用的临时寄存器达到这个数目时，把等待中的操作数暂存到溢出区
+    static constexpr uint32_t SPILL_THRESHOLD = 1024;
+
+    // 后序遍历表达式时的操作数：已经在寄存器 reg_ 中，或者还不在寄存器中（reg_ 为 NO_REGISTER）：
+    // 常量，或者暂存在溢出区中的值，到运算符使用它时才用 load_ 从常量池或者溢出区的 index_ 处装入
+    struct Operand {
+        uint32_t reg_;
+        OpCode load_ = OP_LOADI;
+        uint32_t index_ = 0;
+    };
+
+    // 计算表达式的值，尽量直接放入 target 寄存器；target 为 NO_REGISTER 时由编译器决定，返回值所在的寄存器。
+    // 用显式栈按后序遍历，不递归
+    uint32_t compileExpr(ASTNode *node, uint32_t target);
+
+    // 表达式的根节点写入目标寄存器（如果有），其余节点写入新分配的临时寄存器
+    uint32_t destination(ASTNode *node);
+
+    // 取出一个操作数所在的寄存器，并归还它占用的临时寄存器
+    uint32_t popOperand();
+
+    // 把 results_[index] 处还不在寄存器中的操作数装入 dst，dst 为 NO_REGISTER 时装入新分配的临时寄存器
+    void load(size_t index, uint32_t dst = NO_REGISTER);
+
+    // 在运算符节点的结果入栈之后调用：临时寄存器用到 spill_limit_ 时，把栈顶之外占用临时寄存器的操作数
+    // 依次存入溢出区，栈顶的结果移到第一个临时寄存器。求值的顺序不变，表达式的深度不受寄存器数目的限制
+    void spill();
+
+    uint32_t allocTemp();
+
+    uint32_t constant(double value);
+
+    uint32_t integerConstant(int64_t value);
+
+    // 把 results_[index] 处的 INTEGER 操作数转换为 REAL：常量改为实数常量，临时寄存器原地转换，
+    // 变量寄存器转换到新的临时寄存器
+    void promote(size_t index);
+
+    void emit(OpCode op, uint32_t a, uint32_t b = 0, uint32_t c = 0);
+
+    BytecodeProgram program_;
+    std::unordered_map<Identifier, uint32_t> registers_;
+    std::unordered_set<uint32_t> assigned_;
+    std::unordered_map<double, uint32_t> constant_index_;
+    std::unordered_map<int64_t, uint32_t> integer_constant_index_;
+    uint32_t next_temp_ = 0;
+    uint32_t spill_limit_ = 0;
+    // 溢出区与临时寄存器一样按栈分配：操作数按后进先出的顺序使用
+    uint32_t next_spill_ = 0;
+    // 正在编译的表达式的根节点以及目标寄存器
+    ASTNode *expr_root_ = nullptr;
+    uint32_t target_ = NO_REGISTER;
+    ExpressionWalker<BytecodeCompiler> walker_;
+    // 后序遍历表达式时的操作数
+    std::vector<Operand> results_;
+    // results_ 中 [0, spilled_) 的操作数都不占用临时寄存器，spill 只需检查之后的部分
+    size_t spilled_ = 0;
+};
+
+#endif
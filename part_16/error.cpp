@@ -7,6 +7,10 @@ std::string toString(ErrorCode code) {
         return "ID not found";
     } else if (code == DUPLICATE_ID) {
         return "Duplicate ID";
+    } else if (code == NESTING_TOO_DEEP) {
+        return "Nesting too deep";
+    } else if (code == TYPE_MISMATCH) {
+        return "Type mismatch";
     }
     return "";
 }
@@ -3,7 +3,6 @@
 
 #include <exception>
 #include <optional>
-#include <sstream>
 #include <unordered_map>
 
 #include "token.hpp"
@@ -12,6 +11,8 @@ enum ErrorCode : uint32_t {
     UNEXPECTED_TOKEN,
     ID_NOT_FOUND,
     DUPLICATE_ID,
+    NESTING_TOO_DEEP,
+    TYPE_MISMATCH,
 };
 
 std::string toString(ErrorCode code);
@@ -19,13 +20,12 @@ std::string toString(ErrorCode code);
 class Error : public std::exception {
    public:
     Error(std::string message) : message_(std::move(message)) {}
-    Error(ErrorCode error_code, Token token, std::string message)
+    // token 的文本与位置从 source 中还原
+    Error(ErrorCode error_code, Token token, const Source &source, std::string message)
         : error_code_(error_code), token_(token), message_(std::move(message)) {
         message_ = toString(error_code);
         message_ += "->";
-        std::stringstream ss;
-        ss << token;
-        message_ += ss.str();
+        message_ += toString(token, source);
     }
 
     virtual const char* what() const throw() { return message_.c_str(); }
@@ -44,12 +44,14 @@ class LexerError : public Error {
 
 class ParserError : public Error {
    public:
-    ParserError(ErrorCode error_code, Token token, std::string message) : Error(error_code, token, message) {}
+    ParserError(ErrorCode error_code, Token token, const Source &source, std::string message)
+        : Error(error_code, token, source, message) {}
 };
 
 class SemanticError : public Error {
    public:
-    SemanticError(ErrorCode error_code, Token token, std::string message) : Error(error_code, token, message) {}
+    SemanticError(ErrorCode error_code, Token token, const Source &source, std::string message)
+        : Error(error_code, token, source, message) {}
 };
 
 #endif
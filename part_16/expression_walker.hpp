@@ -0,0 +1,91 @@
+#ifndef EXPRESSION_WALKER_HPP_
+#define EXPRESSION_WALKER_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "ast.hpp"
+
+// 用显式栈按后序遍历表达式树：先从左到右访问操作数，最后访问运算符节点本身，
+// 不占用原生调用栈，任意深的表达式都不会栈溢出。
+// 只展开 BinaryOpNode、UnaryOpNode 的操作数，其余节点视为叶子；V 的 visit 不应再递归访问操作数，
+// 通常把结果压入自己的值栈，运算符节点从值栈中取出操作数的结果。
+// 每个节点只经过一次虚函数分派（区分节点类型），对 V 的调用是静态绑定的。
+// 栈在多次遍历之间复用，各遍把它作为成员持有。
+template <typename V>
+class ExpressionWalker : public Visitor {
+   public:
+    void walk(ASTNode *root, V *visitor) {
+        auto saved = visitor_;
+        visitor_ = visitor;
+        auto base = stack_.size();
+        auto node = root;
+        for (;;) {
+            // 沿左操作数一直向下，右操作数与运算符节点留在栈上
+            while (node != nullptr) {
+                next_ = nullptr;
+                node->visit(this);
+                node = next_;
+            }
+            if (stack_.size() == base) {
+                break;
+            }
+            auto entry = stack_.back();
+            stack_.pop_back();
+            auto action = entry & ACTION_MASK;
+            node = reinterpret_cast<ASTNode *>(entry & ~ACTION_MASK);
+            if (action == FINISH_BINARY) {
+                visitor_->V::visit(static_cast<BinaryOpNode *>(node));
+                node = nullptr;
+            } else if (action == FINISH_UNARY) {
+                visitor_->V::visit(static_cast<UnaryOpNode *>(node));
+                node = nullptr;
+            }
+        }
+        visitor_ = saved;
+    }
+
+    // 后入栈的先处理：运算符节点在操作数之后访问
+    void visit(BinaryOpNode *node) override {
+        push(node, FINISH_BINARY);
+        push(node->right_, VISIT);
+        next_ = node->left_;
+    }
+    void visit(UnaryOpNode *node) override {
+        push(node, FINISH_UNARY);
+        next_ = node->expr_;
+    }
+
+    void visit(NumNode *node) override { visitor_->V::visit(node); }
+    void visit(VarNode *node) override { visitor_->V::visit(node); }
+    void visit(CompoundNode *node) override { visitor_->V::visit(node); }
+    void visit(AssignNode *node) override { visitor_->V::visit(node); }
+    void visit(NoOpNode *node) override { visitor_->V::visit(node); }
+    void visit(ProgramNode *node) override { visitor_->V::visit(node); }
+    void visit(BlockNode *node) override { visitor_->V::visit(node); }
+    void visit(VarDeclNode *node) override { visitor_->V::visit(node); }
+    void visit(TypeNode *node) override { visitor_->V::visit(node); }
+    void visit(ProcedureDecl *node) override { visitor_->V::visit(node); }
+    void visit(ParamNode *node) override { visitor_->V::visit(node); }
+    void visit(ProcedureCallNode *node) override { visitor_->V::visit(node); }
+
+   private:
+    enum Action : uintptr_t {
+        VISIT,          // 按节点类型分派
+        FINISH_BINARY,  // 操作数已经访问过，访问二元运算符节点本身
+        FINISH_UNARY,   // 操作数已经访问过，访问一元运算符节点本身
+    };
+
+    // 节点至少按指针大小对齐，Action 存放在指针的低位，栈中每一项只有一个字
+    static constexpr uintptr_t ACTION_MASK = 3;
+    static_assert(alignof(ASTNode) > ACTION_MASK, "node pointers need spare low bits");
+
+    void push(ASTNode *node, Action action) { stack_.push_back(reinterpret_cast<uintptr_t>(node) | action); }
+
+    V *visitor_ = nullptr;
+    // 下一个要访问的节点（当前节点的左操作数）
+    ASTNode *next_ = nullptr;
+    std::vector<uintptr_t> stack_;
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "flat_ast.hpp"
+
+#include <unordered_map>
+
+#include "expression_walker.hpp"
+#include "program.hpp"
+
+namespace {
+
+// flatten 建立的各个数组，FlatAST 中的视图指向这里
+struct FlatArrays {
+    std::vector<NodeKind> kinds_;
+    std::vector<uint32_t> lhs_;
+    std::vector<uint32_t> rhs_;
+    std::vector<Token> tokens_;
+    std::vector<uint32_t> extra_;
+    std::vector<Value> numbers_;
+};
+
+class FlatBuilder : public Visitor {
+   public:
+    explicit FlatBuilder(const ParsedProgram &program) : program_(program) {}
+
+    FlatAST build() {
+        program_.root()->visit(this);
+        auto arrays = std::make_shared<const FlatArrays>(std::move(arrays_));
+        ast_.kinds_ = FlatArray<NodeKind>(arrays->kinds_);
+        ast_.lhs_ = FlatArray<uint32_t>(arrays->lhs_);
+        ast_.rhs_ = FlatArray<uint32_t>(arrays->rhs_);
+        ast_.tokens_ = FlatArray<Token>(arrays->tokens_);
+        ast_.extra_ = FlatArray<uint32_t>(arrays->extra_);
+        ast_.numbers_ = FlatArray<Value>(arrays->numbers_);
+        ast_.storage_ = std::move(arrays);
+        ast_.root_ = result_;
+        ast_.source_ = program_.source();
+        return std::move(ast_);
+    }
+
+    void visit(ProgramNode *node) override {
+        auto name = nameIndex(node->name_);
+        auto block = buildChild(node->block_);
+        result_ = add(NODE_PROGRAM, name, block, Token());
+    }
+
+    void visit(BlockNode *node) override {
+        std::vector<uint32_t> declarations;
+        for (auto &&declaration : node->declarations_) {
+            declarations.push_back(buildChild(declaration));
+        }
+        auto compound = buildChild(node->compound_statement_);
+        result_ = add(NODE_BLOCK, addList(declarations), compound, Token());
+    }
+
+    void visit(VarDeclNode *node) override {
+        auto &token = node->var_node_->token_;
+        result_ = add(NODE_VAR_DECL, nameIndex(node->var_node_->id_), node->type_node_->token_.type_, token);
+    }
+
+    void visit(TypeNode *node) override {}
+
+    void visit(ProcedureDecl *node) override {
+        auto name = nameIndex(node->proc_name_);
+        std::vector<uint32_t> params;
+        for (auto &&param : node->params_) {
+            params.push_back(buildChild(param));
+        }
+        auto block = buildChild(program_.body(node));
+        auto extra = static_cast<uint32_t>(arrays_.extra_.size());
+        arrays_.extra_.push_back(block);
+        addList(params);
+        result_ = add(NODE_PROCEDURE_DECL, name, extra, Token());
+    }
+
+    void visit(ParamNode *node) override {
+        auto &token = node->var_node_->token_;
+        result_ = add(NODE_PARAM, nameIndex(node->var_node_->id_), node->type_node_->token_.type_, token);
+    }
+
+    void visit(CompoundNode *node) override {
+        std::vector<uint32_t> children;
+        for (const auto &child : node->children_) {
+            children.push_back(buildChild(child));
+        }
+        result_ = add(NODE_COMPOUND, addList(children), 0, Token());
+    }
+
+    void visit(AssignNode *node) override {
+        auto right = buildExpr(node->right_);
+        result_ = add(NODE_ASSIGN, nameIndex(node->left_), right, node->token_);
+    }
+
+    void visit(ProcedureCallNode *node) override {
+        std::vector<uint32_t> params;
+        for (const auto &param : node->actual_params_) {
+            params.push_back(buildExpr(param));
+        }
+        result_ = add(NODE_PROCEDURE_CALL, nameIndex(node->proc_name_), addList(params), node->token_);
+    }
+
+    void visit(NoOpNode *node) override { result_ = add(NODE_NO_OP, 0, 0, Token()); }
+
+    // 表达式节点由 buildExpr 按后序访问：操作数已经加入，下标在 operands_ 栈顶
+    void visit(BinaryOpNode *node) override {
+        auto right = popOperand();
+        auto left = popOperand();
+        NodeKind kind = NODE_ADD;
+        if (node->op_.type_ == MINUS) {
+            kind = NODE_SUB;
+        } else if (node->op_.type_ == MUL) {
+            kind = NODE_MUL;
+        } else if (node->op_.type_ == INTEGER_DIV) {
+            kind = NODE_INTEGER_DIV;
+        } else if (node->op_.type_ == FLOAT_DIV) {
+            kind = NODE_FLOAT_DIV;
+        }
+        operands_.push_back(add(kind, left, right, node->op_));
+    }
+
+    void visit(UnaryOpNode *node) override {
+        auto operand = popOperand();
+        operands_.push_back(add(node->token_.type_ == PLUS ? NODE_PLUS : NODE_MINUS, operand, 0, node->token_));
+    }
+
+    void visit(NumNode *node) override {
+        auto index = static_cast<uint32_t>(arrays_.numbers_.size());
+        arrays_.numbers_.push_back(node->isReal() ? realValue(node->real()) : integerValue(node->integer()));
+        operands_.push_back(add(NODE_NUM, index, 0, node->token_));
+    }
+
+    void visit(VarNode *node) override { operands_.push_back(add(NODE_VAR, nameIndex(node->id_), 0, node->token_)); }
+
+   private:
+    NodeIndex buildChild(ASTNode *node) {
+        node->visit(this);
+        return result_;
+    }
+
+    // 表达式用显式栈按后序遍历，不递归；节点因此按后序连续存放
+    NodeIndex buildExpr(ASTNode *node) {
+        walker_.walk(node, this);
+        return popOperand();
+    }
+
+    NodeIndex popOperand() {
+        auto index = operands_.back();
+        operands_.pop_back();
+        return index;
+    }
+
+    NodeIndex add(NodeKind kind, uint32_t lhs, uint32_t rhs, const Token &token) {
+        auto index = static_cast<NodeIndex>(arrays_.kinds_.size());
+        arrays_.kinds_.push_back(kind);
+        arrays_.lhs_.push_back(lhs);
+        arrays_.rhs_.push_back(rhs);
+        arrays_.tokens_.push_back(token);
+        return index;
+    }
+
+    uint32_t addList(const std::vector<uint32_t> &items) {
+        auto start = static_cast<uint32_t>(arrays_.extra_.size());
+        arrays_.extra_.push_back(static_cast<uint32_t>(items.size()));
+        arrays_.extra_.insert(arrays_.extra_.end(), items.begin(), items.end());
+        return start;
+    }
+
+    uint32_t nameIndex(Identifier name) {
+        auto it = name_ids_.find(name);
+        if (it != name_ids_.end()) {
+            return it->second;
+        }
+        auto index = static_cast<uint32_t>(ast_.names_.size());
+        ast_.names_.push_back(name);
+        name_ids_.emplace(name, index);
+        return index;
+    }
+
+    const ParsedProgram &program_;
+    FlatArrays arrays_;
+    FlatAST ast_;
+    std::unordered_map<Identifier, uint32_t> name_ids_;
+    NodeIndex result_ = 0;
+    ExpressionWalker<FlatBuilder> walker_;
+    std::vector<NodeIndex> operands_;
+};
+
+}  // namespace
+
+FlatAST flatten(const ParsedProgram &program) {
+    return FlatBuilder(program).build();
+}
@@ -0,0 +1,107 @@
+#ifndef FLAT_AST_HPP_
+#define FLAT_AST_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ast.hpp"
+#include "identifier.hpp"
+#include "token.hpp"
+#include "value.hpp"
+
+// 扁平 AST 的节点类型。二元、一元运算符直接编码进节点类型，遍历时只需一次 switch。
+enum NodeKind : uint8_t {
+    NODE_PROGRAM,         // lhs: 名字, rhs: block
+    NODE_BLOCK,           // lhs: extra 中声明列表的起点, rhs: compound
+    NODE_VAR_DECL,        // lhs: 名字, rhs: 类型（TokenType）
+    NODE_PROCEDURE_DECL,  // lhs: 名字, rhs: extra 中 [block, 参数列表] 的起点
+    NODE_PARAM,           // lhs: 名字, rhs: 类型（TokenType）
+    NODE_COMPOUND,        // lhs: extra 中语句列表的起点
+    NODE_ASSIGN,          // lhs: 名字, rhs: 表达式
+    NODE_PROCEDURE_CALL,  // lhs: 名字, rhs: extra 中实参列表的起点
+    NODE_NO_OP,
+    NODE_ADD,             // lhs, rhs: 操作数
+    NODE_SUB,             // lhs, rhs: 操作数
+    NODE_MUL,             // lhs, rhs: 操作数
+    NODE_INTEGER_DIV,     // lhs, rhs: 操作数
+    NODE_FLOAT_DIV,       // lhs, rhs: 操作数
+    NODE_PLUS,            // lhs: 操作数
+    NODE_MINUS,           // lhs: 操作数
+    NODE_NUM,             // lhs: numbers_ 下标
+    NODE_VAR,             // lhs: 名字
+};
+
+using NodeIndex = uint32_t;
+
+// FlatAST 中只读数组的视图，元素存放在 FlatAST::storage_ 中
+template <typename T>
+class FlatArray {
+   public:
+    FlatArray() = default;
+    FlatArray(const T *data, size_t size) : data_(data), size_(size) {}
+    explicit FlatArray(const std::vector<T> &items) : data_(items.data()), size_(items.size()) {}
+
+    const T *data() const { return data_; }
+    const T *begin() const { return data_; }
+    const T *end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+    const T &operator[](size_t i) const { return data_[i]; }
+
+   private:
+    const T *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// 结构体数组（SoA）布局的 AST：节点 i 的类型、两个 32 位操作数和对应的 token 分别存放在
+// kinds_[i]、lhs_[i]、rhs_[i]、tokens_[i] 中。变长的子节点列表存放在 extra_ 中，
+// 以长度开头：extra_[start] = n，随后是 n 个节点下标。names_ 是本程序用到的标识符的驻留编号，
+// 节点中的名字是 names_ 的下标，因此各遍可以用紧凑的数组代替哈希表。
+// 一个表达式的所有节点按后序连续存放：以 root 为根的表达式占据 [exprBegin(root), root]，
+// 按下标顺序扫描这一段、用值栈计算即可求值，不需要递归。
+// 除 names_ 以外的数组只用下标互相引用，与所在的地址无关，可以原样写入文件、映射回来直接使用（见 ast_cache.hpp）。
+struct FlatAST {
+    FlatArray<NodeKind> kinds_;
+    FlatArray<uint32_t> lhs_;
+    FlatArray<uint32_t> rhs_;
+    FlatArray<Token> tokens_;
+    FlatArray<uint32_t> extra_;
+    // 常量的值，按 token 的类型（INTEGER_CONST、REAL_CONST）读取
+    FlatArray<Value> numbers_;
+    // 各节点的静态类型，由 FlatSemanticAnalyzer 写入：表达式为推导出的类型，赋值为目标变量的类型，
+    // 变量声明为声明的类型，其余节点为 TYPE_UNKNOWN
+    FlatArray<ValueType> types_;
+    // 驻留编号只在本进程内有效，因此总是在本进程中建立
+    std::vector<Identifier> names_;
+    NodeIndex root_ = 0;
+    // tokens_ 所在的源码，用于报错
+    std::shared_ptr<const Source> source_;
+    // 以上数组所在的存储：flatten 建立的 vector，或者只读映射的缓存文件
+    std::shared_ptr<const void> storage_;
+    // types_ 所在的存储：FlatSemanticAnalyzer 建立的 vector；缓存命中时 types_ 指向映射，这里为空
+    std::shared_ptr<const void> types_storage_;
+
+    size_t size() const { return kinds_.size(); }
+
+    // extra_ 中从 start 开始的列表
+    const uint32_t *listBegin(uint32_t start) const { return extra_.data() + start + 1; }
+    const uint32_t *listEnd(uint32_t start) const { return extra_.data() + start + 1 + extra_[start]; }
+
+    // 表达式 root 的第一个节点，即沿左操作数一直向下到达的叶子
+    NodeIndex exprBegin(NodeIndex root) const {
+        while (kinds_[root] >= NODE_ADD && kinds_[root] <= NODE_MINUS) {
+            root = lhs_[root];
+        }
+        return root;
+    }
+
+    // 节点对应的 token，用于报错
+    const Token &token(NodeIndex node) const { return tokens_[node]; }
+};
+
+class ParsedProgram;
+
+// 把 Arena 中的树形 AST 转换为扁平 AST，惰性分析的过程体在这里全部建立
+FlatAST flatten(const ParsedProgram &program);
+
+#endif
@@ -0,0 +1,155 @@
+#include "flat_interpreter.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "trace.hpp"
+
+void FlatInterpreter::interpret() {
+    if (values_.size() != ast_.names_.size()) {
+        values_.assign(ast_.names_.size(), Value());
+        types_.assign(ast_.names_.size(), TYPE_UNKNOWN);
+        states_.assign(ast_.names_.size(), UNDECLARED);
+    }
+    auto root = ast_.root_;
+    std::cout << identifiers().name(ast_.names_[ast_.lhs_[root]]) << ": " << std::endl;
+    TRACE(TRACE_INTERPRETER, TRACE_INFO, "run " << identifiers().name(ast_.names_[ast_.lhs_[root]]) << " (flat)");
+
+    // 只执行全局作用域：声明全局变量，过程声明暂不处理
+    auto block = ast_.rhs_[root];
+    auto declarations = ast_.lhs_[block];
+    for (auto it = ast_.listBegin(declarations); it != ast_.listEnd(declarations); ++it) {
+        if (ast_.kinds_[*it] == NODE_VAR_DECL && states_[ast_.lhs_[*it]] == UNDECLARED) {
+            states_[ast_.lhs_[*it]] = DECLARED;
+            types_[ast_.lhs_[*it]] = ast_.types_[*it];
+        }
+    }
+    execute(ast_.rhs_[block]);
+}
+
+void FlatInterpreter::printGlobalScope() {
+    std::unordered_map<Identifier, double> scope;
+    for (auto name : assigned_) {
+        scope[ast_.names_[name]] = toReal(values_[name], types_[name]);
+    }
+    std::cout << "GLOBAL_SCOPE.size() = " << scope.size() << std::endl;
+    for (const auto &[identifier, value] : scope) {
+        std::cout << identifiers().name(identifier) << ": " << value << std::endl;
+    }
+}
+
+void FlatInterpreter::execute(NodeIndex node) {
+    switch (ast_.kinds_[node]) {
+        case NODE_COMPOUND: {
+            auto children = ast_.lhs_[node];
+            for (auto it = ast_.listBegin(children); it != ast_.listEnd(children); ++it) {
+                execute(*it);
+            }
+            break;
+        }
+        case NODE_ASSIGN: {
+            auto name = ast_.lhs_[node];
+            if (states_[name] == UNDECLARED) {
+                throw std::runtime_error("identifier " + std::string(identifiers().name(ast_.names_[name])) + " not declare");
+            }
+            auto value = evaluate(ast_.rhs_[node]);
+            if (ast_.types_[node] == TYPE_REAL && ast_.types_[ast_.rhs_[node]] == TYPE_INTEGER) {
+                value = realValue(static_cast<double>(value.integer_));
+            }
+            values_[name] = value;
+            TRACE(TRACE_INTERPRETER, TRACE_DEBUG,
+                  identifiers().name(ast_.names_[name]) << " := " << toReal(value, ast_.types_[node]));
+            if (states_[name] != ASSIGNED) {
+                states_[name] = ASSIGNED;
+                assigned_.push_back(name);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+Value FlatInterpreter::evaluate(NodeIndex node) {
+    stack_.clear();
+    for (auto i = ast_.exprBegin(node); i <= node; ++i) {
+        switch (ast_.kinds_[i]) {
+            case NODE_ADD:
+            case NODE_SUB:
+            case NODE_MUL:
+            case NODE_INTEGER_DIV:
+            case NODE_FLOAT_DIV:
+                binary(i);
+                break;
+            case NODE_PLUS:
+                break;
+            case NODE_MINUS:
+                if (ast_.types_[i] == TYPE_INTEGER) {
+                    stack_.back().integer_ = integerNegate(stack_.back().integer_);
+                } else {
+                    stack_.back().real_ = -stack_.back().real_;
+                }
+                break;
+            case NODE_NUM:
+                stack_.push_back(ast_.numbers_[ast_.lhs_[i]]);
+                break;
+            case NODE_VAR: {
+                auto name = ast_.lhs_[i];
+                if (states_[name] != ASSIGNED) {
+                    throw std::runtime_error("variable " + std::string(identifiers().name(ast_.names_[name])) +
+                                             " is not defined");
+                }
+                stack_.push_back(values_[name]);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return stack_.back();
+}
+
+void FlatInterpreter::binary(NodeIndex node) {
+    auto right = stack_.back();
+    stack_.pop_back();
+    auto &left = stack_.back();
+    if (ast_.types_[node] == TYPE_INTEGER) {
+        switch (ast_.kinds_[node]) {
+            case NODE_ADD:
+                left.integer_ = integerAdd(left.integer_, right.integer_);
+                break;
+            case NODE_SUB:
+                left.integer_ = integerSubtract(left.integer_, right.integer_);
+                break;
+            case NODE_MUL:
+                left.integer_ = integerMultiply(left.integer_, right.integer_);
+                break;
+            case NODE_INTEGER_DIV:
+                left.integer_ = integerDivide(left.integer_, right.integer_);
+                break;
+            default:
+                break;
+        }
+        return;
+    }
+    // 实数运算，INTEGER 的操作数先提升为 REAL
+    auto x = toReal(left, ast_.types_[ast_.lhs_[node]]);
+    auto y = toReal(right, ast_.types_[ast_.rhs_[node]]);
+    switch (ast_.kinds_[node]) {
+        case NODE_ADD:
+            left.real_ = x + y;
+            break;
+        case NODE_SUB:
+            left.real_ = x - y;
+            break;
+        case NODE_MUL:
+            left.real_ = x * y;
+            break;
+        case NODE_FLOAT_DIV:
+            left.real_ = x / y;
+            break;
+        default:
+            break;
+    }
+}
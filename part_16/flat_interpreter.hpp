@@ -0,0 +1,41 @@
+#ifndef FLAT_INTERPRETER_HPP_
+#define FLAT_INTERPRETER_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "flat_ast.hpp"
+
+// 在扁平 AST 上执行程序，语义与 Interpreter 一致。
+// 全局变量按 FlatAST::names_ 的下标存放在数组中；运算按 FlatAST::types_ 中的静态类型使用整数或者实数运算。
+class FlatInterpreter {
+   public:
+    explicit FlatInterpreter(const FlatAST &ast) : ast_(ast) {}
+
+    void interpret();
+
+    void printGlobalScope();
+
+   private:
+    enum VariableState : uint8_t { UNDECLARED, DECLARED, ASSIGNED };
+
+    void execute(NodeIndex node);
+
+    // 按下标顺序扫描表达式的节点（后序），用 stack_ 求值，不递归。结果按 ast_.types_[node] 读取
+    Value evaluate(NodeIndex node);
+
+    // 二元运算：栈顶两个操作数替换为结果
+    void binary(NodeIndex node);
+
+    const FlatAST &ast_;
+    std::vector<Value> values_;
+    // 全局变量的类型，来自变量声明
+    std::vector<ValueType> types_;
+    std::vector<VariableState> states_;
+    // 按首次赋值的顺序记录变量，输出与 Interpreter 保持一致
+    std::vector<uint32_t> assigned_;
+    // 求值时的操作数栈
+    std::vector<Value> stack_;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "flat_semantic_analyzer.hpp"
+
+void FlatSemanticAnalyzer::check() {
+    declarations_.assign(ast_.names_.size(), {});
+    scopes_.clear();
+    types_.clear();
+    types_of_ = std::make_shared<std::vector<ValueType>>(ast_.size(), TYPE_UNKNOWN);
+    enterScope();
+    checkBlock(ast_.rhs_[ast_.root_]);
+    leaveScope();
+    ast_.types_ = FlatArray<ValueType>(*types_of_);
+    ast_.types_storage_ = std::move(types_of_);
+}
+
+void FlatSemanticAnalyzer::leaveScope() {
+    for (auto name : scopes_.back()) {
+        declarations_[name].pop_back();
+    }
+    scopes_.pop_back();
+}
+
+namespace {
+
+// 声明中的类型名
+ValueType declaredType(uint32_t type) {
+    return type == INTEGER ? TYPE_INTEGER : type == REAL ? TYPE_REAL : TYPE_UNKNOWN;
+}
+
+}  // namespace
+
+bool FlatSemanticAnalyzer::define(uint32_t name, ValueType type) {
+    auto depth = static_cast<uint32_t>(scopes_.size());
+    auto &stack = declarations_[name];
+    if (!stack.empty() && stack.back().depth_ == depth) {
+        return false;
+    }
+    stack.push_back({depth, type});
+    scopes_.back().push_back(name);
+    return true;
+}
+
+void FlatSemanticAnalyzer::checkBlock(NodeIndex block) {
+    auto declarations = ast_.lhs_[block];
+    for (auto it = ast_.listBegin(declarations); it != ast_.listEnd(declarations); ++it) {
+        auto node = *it;
+        if (ast_.kinds_[node] == NODE_VAR_DECL) {
+            (*types_of_)[node] = declaredType(ast_.rhs_[node]);
+            if (!define(ast_.lhs_[node], (*types_of_)[node])) {
+                error(DUPLICATE_ID, node);
+            }
+        } else if (ast_.kinds_[node] == NODE_PROCEDURE_DECL) {
+            define(ast_.lhs_[node], TYPE_UNKNOWN);
+            enterScope();
+            auto extra = ast_.rhs_[node];
+            auto params = extra + 1;
+            for (auto param = ast_.listBegin(params); param != ast_.listEnd(params); ++param) {
+                (*types_of_)[*param] = declaredType(ast_.rhs_[*param]);
+                define(ast_.lhs_[*param], (*types_of_)[*param]);
+            }
+            checkBlock(ast_.extra_[extra]);
+            leaveScope();
+        }
+    }
+    checkStatement(ast_.rhs_[block]);
+}
+
+void FlatSemanticAnalyzer::checkStatement(NodeIndex node) {
+    switch (ast_.kinds_[node]) {
+        case NODE_COMPOUND: {
+            auto children = ast_.lhs_[node];
+            for (auto it = ast_.listBegin(children); it != ast_.listEnd(children); ++it) {
+                checkStatement(*it);
+            }
+            break;
+        }
+        case NODE_ASSIGN:
+            if (!visible(ast_.lhs_[node])) {
+                error(ID_NOT_FOUND, node);
+            }
+            (*types_of_)[node] = typeOf(ast_.lhs_[node]);
+            if (checkExpr(ast_.rhs_[node]) == TYPE_REAL && (*types_of_)[node] == TYPE_INTEGER) {
+                error(TYPE_MISMATCH, node);
+            }
+            break;
+        case NODE_PROCEDURE_CALL: {
+            if (!visible(ast_.lhs_[node])) {
+                error(ID_NOT_FOUND, node);
+            }
+            auto params = ast_.rhs_[node];
+            for (auto it = ast_.listBegin(params); it != ast_.listEnd(params); ++it) {
+                checkExpr(*it);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// 表达式的节点按后序连续存放，按下标顺序扫描、用类型栈即可从左到右检查其中的变量并推导类型，不递归
+ValueType FlatSemanticAnalyzer::checkExpr(NodeIndex node) {
+    auto base = types_.size();
+    for (auto i = ast_.exprBegin(node); i <= node; ++i) {
+        switch (ast_.kinds_[i]) {
+            case NODE_NUM:
+                types_.push_back(ast_.token(i).type_ == REAL_CONST ? TYPE_REAL : TYPE_INTEGER);
+                break;
+            case NODE_VAR:
+                if (!visible(ast_.lhs_[i])) {
+                    error(ID_NOT_FOUND, i);
+                }
+                types_.push_back(typeOf(ast_.lhs_[i]));
+                break;
+            case NODE_PLUS:
+            case NODE_MINUS:
+                // 一元运算不改变类型
+                break;
+            default: {
+                auto right = types_.back();
+                types_.pop_back();
+                auto &left = types_.back();
+                if (left == TYPE_UNKNOWN || right == TYPE_UNKNOWN) {
+                    // 操作数不是变量，执行时报告
+                    left = TYPE_UNKNOWN;
+                } else if (ast_.kinds_[i] == NODE_INTEGER_DIV) {
+                    if (left != TYPE_INTEGER || right != TYPE_INTEGER) {
+                        error(TYPE_MISMATCH, i);
+                    }
+                } else if (ast_.kinds_[i] == NODE_FLOAT_DIV) {
+                    left = TYPE_REAL;
+                } else if (right == TYPE_REAL) {
+                    left = TYPE_REAL;
+                }
+                break;
+            }
+        }
+        (*types_of_)[i] = types_.back();
+    }
+    auto type = types_.back();
+    types_.resize(base);
+    return type;
+}
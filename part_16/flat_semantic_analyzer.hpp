@@ -0,0 +1,59 @@
+#ifndef FLAT_SEMANTIC_ANALYZER_HPP_
+#define FLAT_SEMANTIC_ANALYZER_HPP_
+
+#include <vector>
+
+#include "error.hpp"
+#include "flat_ast.hpp"
+#include "value.hpp"
+
+// 在扁平 AST 上做与 SemanticAnalyzer 相同的检查，包括按相同规则推导、检查表达式的类型。
+// 推导出的类型写入 FlatAST::types_，供 FlatInterpreter 选择整数或者实数运算。
+// 名字在 FlatAST 中已经去重，作用域直接用按名字下标索引的数组表示，无需哈希。
+class FlatSemanticAnalyzer {
+   public:
+    explicit FlatSemanticAnalyzer(FlatAST &ast) : ast_(ast) {}
+
+    void check();
+
+   private:
+    void checkBlock(NodeIndex block);
+
+    void checkStatement(NodeIndex node);
+
+    // 返回表达式的类型
+    ValueType checkExpr(NodeIndex node);
+
+    void enterScope() { scopes_.emplace_back(); }
+
+    void leaveScope();
+
+    // 返回 false 表示名字已在当前作用域中定义。type 为变量的类型，过程为 TYPE_UNKNOWN
+    bool define(uint32_t name, ValueType type);
+
+    bool visible(uint32_t name) const { return !declarations_[name].empty(); }
+
+    // 名字当前可见的声明的类型
+    ValueType typeOf(uint32_t name) const { return declarations_[name].back().type_; }
+
+    void error(ErrorCode error_code, NodeIndex node) {
+        throw SemanticError(error_code, ast_.token(node), *ast_.source_, "");
+    }
+
+    struct Declaration {
+        uint32_t depth_;
+        ValueType type_;
+    };
+
+    FlatAST &ast_;
+    // 各节点的类型，检查结束后成为 ast_.types_
+    std::shared_ptr<std::vector<ValueType>> types_of_;
+    // declarations_[name] 是定义了该名字的作用域深度栈
+    std::vector<std::vector<Declaration>> declarations_;
+    // 检查表达式时各操作数的类型
+    std::vector<ValueType> types_;
+    // scopes_[depth] 是该作用域中定义的名字
+    std::vector<std::vector<uint32_t>> scopes_;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#include "identifier.hpp"
+
+#include <mutex>
+
+Identifier Interner::intern(std::string_view name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = ids_.find(name);
+        if (it != ids_.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    // 加写锁之前可能已被其它线程插入
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    auto *data = static_cast<char *>(arena_.allocate(name.size(), 1));
+    for (size_t i = 0; i < name.size(); ++i) {
+        data[i] = foldCase(name[i]);
+    }
+    auto stored = std::string_view(data, name.size());
+    auto id = static_cast<Identifier>(names_.size());
+    names_.push_back(stored);
+    ids_.emplace(stored, id);
+    return id;
+}
+
+std::string_view Interner::name(Identifier id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return names_[id];
+}
+
+size_t Interner::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return names_.size();
+}
+
+Interner &identifiers() {
+    static Interner interner;
+    return interner;
+}
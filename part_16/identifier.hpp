@@ -0,0 +1,82 @@
+#ifndef IDENTIFIER_HPP_
+#define IDENTIFIER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.hpp"
+
+// Pascal 的标识符大小写不敏感。以下函数对象用于以源码中的原始拼写作为 key 的哈希表，
+// 比较时折叠大小写，无需先复制出一份大写字符串。
+
+constexpr char foldCase(char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+struct IdentifierHash {
+    size_t operator()(std::string_view name) const {
+        // FNV-1a
+        size_t hash = 14695981039346656037ULL;
+        for (char c : name) {
+            hash ^= static_cast<unsigned char>(foldCase(c));
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+};
+
+struct IdentifierEqual {
+    bool operator()(std::string_view lhs, std::string_view rhs) const {
+        if (lhs.size() != rhs.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            if (foldCase(lhs[i]) != foldCase(rhs[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// key 通常指向源码或符号中的名字，使用者需保证其生命周期
+template <typename T>
+using IdentifierMap = std::unordered_map<std::string_view, T, IdentifierHash, IdentifierEqual>;
+
+// 驻留后的标识符：进程内唯一、从 0 开始连续分配的编号
+using Identifier = uint32_t;
+
+constexpr Identifier NO_IDENTIFIER = UINT32_MAX;
+
+// 线程安全的标识符驻留池。大小写不同的拼写得到同一个编号，名字统一以大写形式只保存一份，
+// 此后的各个阶段都以编号作为 key，查找与比较都是整数操作。
+class Interner {
+   public:
+    Interner() = default;
+
+    Interner(const Interner &) = delete;
+    Interner &operator=(const Interner &) = delete;
+
+    Identifier intern(std::string_view name);
+
+    // 返回的视图在 Interner 的整个生命周期内有效
+    std::string_view name(Identifier id) const;
+
+    size_t size() const;
+
+   private:
+    mutable std::shared_mutex mutex_;
+    // key 指向 names_ 中的大写名字
+    IdentifierMap<Identifier> ids_;
+    std::vector<std::string_view> names_;
+    Arena arena_{4096};
+};
+
+// 词法分析器、符号表以及各执行引擎共享的驻留池
+Interner &identifiers();
+
+#endif
@@ -1,114 +1,164 @@
 #include "interpreter.hpp"
 
 #include <exception>
+#include <unordered_map>
 
 #include "token.hpp"
+#include "trace.hpp"
 
-double Interpreter::calculate(const std::shared_ptr<ASTNode> &node) {
-    node->visit(shared_from_this());
-    return expr_value_;
+Value Interpreter::calculate(ASTNode *node) {
+    walker_.walk(node, this);
+    auto value = values_.back();
+    values_.pop_back();
+    return value;
 }
 
 void Interpreter::printGlobalScope() {
-    std::cout << "GLOBAL_SCOPE.size() = " << GLOBAL_SCOPE_.size() << std::endl;
-    for (const auto &[identifier, value] : GLOBAL_SCOPE_) {
-        std::cout << identifier + ": " << value << std::endl;
+    std::unordered_map<Identifier, double> scope;
+    for (auto slot : assigned_) {
+        scope[global_names_[slot]] = toReal(frames_[1].values_[slot], global_types_[slot]);
+    }
+    std::cout << "GLOBAL_SCOPE.size() = " << scope.size() << std::endl;
+    for (const auto &[identifier, value] : scope) {
+        std::cout << identifiers().name(identifier) << ": " << value << std::endl;
     }
-}
-
-void Interpreter::printSymbolTable() {
-    std::cout << symbol_table_ << std::endl;
 }
 
 void Interpreter::interpret() {
-    auto root_node = parser_.parse();
-    if (nullptr == root_node) {
-        return;
-    }
-    root_node->visit(shared_from_this());
+    program_->root()->visit(this);
 }
 
-void Interpreter::visit(const std::shared_ptr<ProgramNode> &node) {
-    std::cout << node->name_ << ": " << std::endl;
-    node->block_->visit(shared_from_this());
+void Interpreter::visit(ProgramNode *node) {
+    std::cout << identifiers().name(node->name_) << ": " << std::endl;
+    TRACE(TRACE_INTERPRETER, TRACE_INFO, "run " << identifiers().name(node->name_) << " (tree)");
+    // 多次执行时保留上一次的全局变量
+    auto frame_size = node->block_->frame_size_;
+    frames_.resize(2);
+    if (frames_[1].values_.size() != frame_size) {
+        frames_[1].values_.assign(frame_size, Value());
+        frames_[1].assigned_.assign(frame_size, 0);
+        global_names_.assign(frame_size, NO_IDENTIFIER);
+        global_types_.assign(frame_size, TYPE_UNKNOWN);
+        assigned_.clear();
+    }
+    node->block_->visit(this);
 }
 
-void Interpreter::visit(const std::shared_ptr<BlockNode> &node) {
+void Interpreter::visit(BlockNode *node) {
     for (auto &&declaration : node->declarations_) {
-        declaration->visit(shared_from_this());
+        declaration->visit(this);
     }
-    node->compound_statement_->visit(shared_from_this());
+    node->compound_statement_->visit(this);
 }
 
-void Interpreter::visit(const std::shared_ptr<VarDeclNode> &node) {
-    auto type_name = node->type_node_->token_.str_;
-    auto type_symbol = symbol_table_.lookup(type_name);
-    auto var_name = node->var_node_->value_;
-    auto var_symbol = std::make_shared<VarSymbol>(var_name, type_symbol);
-    symbol_table_.define(var_symbol);
+// 只有全局作用域的声明会被执行到
+void Interpreter::visit(VarDeclNode *node) {
+    global_names_[node->var_node_->binding_.slot_] = node->var_node_->id_;
+    global_types_[node->var_node_->binding_.slot_] = node->var_node_->type_;
 }
 
-void Interpreter::visit(const std::shared_ptr<TypeNode> &node) {
+void Interpreter::visit(TypeNode *node) {
     // TODO
 }
 
-void Interpreter::visit(const std::shared_ptr<ProcedureCallNode> &node) {
+void Interpreter::visit(ProcedureCallNode *node) {
     // TODO
 }
 
-void Interpreter::visit(const std::shared_ptr<BinaryOpNode> &node) {
-    auto this_ptr = shared_from_this();
-    if (node->op_.type_ == PLUS) {
-        expr_value_ = calculate(node->left_) + calculate(node->right_);
-    } else if (node->op_.type_ == MINUS) {
-        expr_value_ = calculate(node->left_) - calculate(node->right_);
-    } else if (node->op_.type_ == MUL) {
-        expr_value_ = calculate(node->left_) * calculate(node->right_);
-    } else if (node->op_.type_ == INTEGER_DIV) {  // 整数除法
-        expr_value_ = static_cast<int>(calculate(node->left_)) / static_cast<int>(calculate(node->right_));
-    } else if (node->op_.type_ == FLOAT_DIV) {
-        expr_value_ = calculate(node->left_) / calculate(node->right_);
+// 表达式节点由 calculate 按后序访问：操作数的值已经在 values_ 栈顶
+void Interpreter::visit(BinaryOpNode *node) {
+    auto right = values_.back();
+    values_.pop_back();
+    auto &left = values_.back();
+    if (node->type_ == TYPE_INTEGER) {
+        switch (node->op_.type_) {
+            case PLUS:
+                left.integer_ = integerAdd(left.integer_, right.integer_);
+                break;
+            case MINUS:
+                left.integer_ = integerSubtract(left.integer_, right.integer_);
+                break;
+            case MUL:
+                left.integer_ = integerMultiply(left.integer_, right.integer_);
+                break;
+            case INTEGER_DIV:
+                left.integer_ = integerDivide(left.integer_, right.integer_);
+                break;
+            default:
+                break;
+        }
+        return;
+    }
+    // 实数运算，INTEGER 的操作数先提升为 REAL
+    auto x = toReal(left, typeOf(node->left_));
+    auto y = toReal(right, typeOf(node->right_));
+    switch (node->op_.type_) {
+        case PLUS:
+            left.real_ = x + y;
+            break;
+        case MINUS:
+            left.real_ = x - y;
+            break;
+        case MUL:
+            left.real_ = x * y;
+            break;
+        case FLOAT_DIV:
+            left.real_ = x / y;
+            break;
+        default:
+            break;
     }
 }
 
-void Interpreter::visit(const std::shared_ptr<NumNode> &node) {
-    expr_value_ = node->value_;
+void Interpreter::visit(NumNode *node) {
+    values_.push_back(node->isReal() ? realValue(node->real()) : integerValue(node->integer()));
 }
 
-void Interpreter::visit(const std::shared_ptr<UnaryOpNode> &node) {
-    auto op = node->token_.type_;
-    auto value = calculate(node->expr_);
-    if (op == PLUS) {
-        expr_value_ = value;
-    } else {
-        expr_value_ = -value;
+void Interpreter::visit(UnaryOpNode *node) {
+    if (node->token_.type_ == MINUS) {
+        auto &value = values_.back();
+        if (node->type_ == TYPE_INTEGER) {
+            value.integer_ = integerNegate(value.integer_);
+        } else {
+            value.real_ = -value.real_;
+        }
     }
 }
 
-void Interpreter::visit(const std::shared_ptr<CompoundNode> &node) {
+void Interpreter::visit(CompoundNode *node) {
     for (const auto &child : node->children_) {
-        child->visit(shared_from_this());
+        child->visit(this);
     }
 }
 
-void Interpreter::visit(const std::shared_ptr<AssignNode> &node) {
-    auto identifier = node->left_;
-    if (!symbol_table_.lookup(identifier)) {
-        throw std::runtime_error("identifier " + identifier + " not declare");
+void Interpreter::visit(AssignNode *node) {
+    auto binding = node->binding_;
+    if (binding.depth_ == 0) {
+        throw std::runtime_error("identifier " + std::string(identifiers().name(node->left_)) + " not declare");
+    }
+    auto value = calculate(node->right_);
+    if (node->type_ == TYPE_REAL && typeOf(node->right_) == TYPE_INTEGER) {
+        value = realValue(static_cast<double>(value.integer_));
+    }
+    TRACE(TRACE_INTERPRETER, TRACE_DEBUG, identifiers().name(node->left_) << " := " << toReal(value, node->type_));
+    auto &frame = frames_[binding.depth_];
+    frame.values_[binding.slot_] = value;
+    if (!frame.assigned_[binding.slot_]) {
+        frame.assigned_[binding.slot_] = 1;
+        assigned_.push_back(binding.slot_);
     }
-    GLOBAL_SCOPE_[identifier] = calculate(node->right_);
 }
 
-void Interpreter::visit(const std::shared_ptr<VarNode> &node) {
-    auto identifier = node->value_;
-    auto it = GLOBAL_SCOPE_.find(identifier);
-    if (it != GLOBAL_SCOPE_.end()) {
-        expr_value_ = it->second;
-    } else {
-        throw std::runtime_error("variable " + identifier + " is not defined");
+void Interpreter::visit(VarNode *node) {
+    auto binding = node->binding_;
+    if (binding.depth_ == 0 || !frames_[binding.depth_].assigned_[binding.slot_]) {
+        throw std::runtime_error("variable " + std::string(identifiers().name(node->id_)) + " is not defined");
     }
+    values_.push_back(frames_[binding.depth_].values_[binding.slot_]);
 }
 
-void Interpreter::visit(const std::shared_ptr<ProcedureDecl> &node) {}
+void Interpreter::visit(ProcedureDecl *node) {}
+
+void Interpreter::visit(NoOpNode *node) {}
 
-void Interpreter::visit(const std::shared_ptr<NoOpNode> &node) {}
\ No newline at end of file
+void Interpreter::visit(ParamNode *node) {}
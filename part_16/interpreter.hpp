@@ -1,56 +1,74 @@
 #ifndef INTERPRETER_HPP
 #define INTERPRETER_HPP
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 #include "ast.hpp"
-#include "parser.hpp"
-#include "symbol.hpp"
+#include "expression_walker.hpp"
+#include "identifier.hpp"
+#include "program.hpp"
 
-class Interpreter : public Visitor, public std::enable_shared_from_this<Interpreter> {
+// 执行已经通过语义分析的 ParsedProgram：变量按语义分析写在节点上的 (层次, 槽位) 直接访问帧中的数组，
+// 执行时不再按名字查找；运算按节点上的静态类型直接使用整数或者实数运算，值本身不带类型
+class Interpreter : public Visitor {
    public:
-    explicit Interpreter(const Parser &parser) : parser_(parser) {}
+    explicit Interpreter(std::shared_ptr<const ParsedProgram> program) : program_(std::move(program)) {}
 
-    double calculate(const std::shared_ptr<ASTNode> &node);
+    // 用显式栈求表达式的值，不递归。结果按 typeOf(node) 读取
+    Value calculate(ASTNode *node);
 
     void printGlobalScope();
 
-    void printSymbolTable();
-
     void interpret();
 
-    void visit(const std::shared_ptr<ProgramNode> &node) override;
+    void visit(ProgramNode *node) override;
+
+    void visit(BlockNode *node) override;
 
-    void visit(const std::shared_ptr<BlockNode> &node) override;
+    void visit(VarDeclNode *node) override;
 
-    void visit(const std::shared_ptr<VarDeclNode> &node) override;
+    void visit(TypeNode *node) override;
 
-    void visit(const std::shared_ptr<TypeNode> &node) override;
+    void visit(BinaryOpNode *node) override;
 
-    void visit(const std::shared_ptr<BinaryOpNode> &node) override;
+    void visit(NumNode *node) override;
 
-    void visit(const std::shared_ptr<NumNode> &node) override;
+    void visit(UnaryOpNode *node) override;
 
-    void visit(const std::shared_ptr<UnaryOpNode> &node) override;
+    void visit(CompoundNode *node) override;
 
-    void visit(const std::shared_ptr<CompoundNode> &node) override;
+    void visit(AssignNode *node) override;
 
-    void visit(const std::shared_ptr<AssignNode> &node) override;
+    void visit(VarNode *node) override;
 
-    void visit(const std::shared_ptr<VarNode> &node) override;
+    void visit(ProcedureDecl *node) override;
 
-    void visit(const std::shared_ptr<ProcedureDecl> &node) override;
+    void visit(ProcedureCallNode *node) override;
 
-    void visit(const std::shared_ptr<ProcedureCallNode> &node) override;
+    void visit(NoOpNode *node) override;
 
-    void visit(const std::shared_ptr<NoOpNode> &node) override;
+    void visit(ParamNode *node) override;
 
    private:
-    Parser parser_;
-    SymbolTable symbol_table_;
-    double expr_value_;
-    std::unordered_map<std::string, double> GLOBAL_SCOPE_;
+    // 一个作用域的帧：各槽位的值以及是否已经赋值
+    struct Frame {
+        std::vector<Value> values_;
+        std::vector<uint8_t> assigned_;
+    };
+
+    std::shared_ptr<const ParsedProgram> program_;
+    ExpressionWalker<Interpreter> walker_;
+    // 后序遍历表达式时操作数的值
+    std::vector<Value> values_;
+    // frames_[depth] 是第 depth 层作用域当前的帧。目前只执行全局作用域，因此只有 frames_[1]
+    std::vector<Frame> frames_;
+    // 全局变量各槽位的名字、类型，以及按首次赋值的顺序记录的槽位，输出与按名字存放时保持一致
+    std::vector<Identifier> global_names_;
+    std::vector<ValueType> global_types_;
+    std::vector<uint32_t> assigned_;
 };
 
 #endif
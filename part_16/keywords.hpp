@@ -0,0 +1,104 @@
+#ifndef KEYWORDS_HPP_
+#define KEYWORDS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "identifier.hpp"
+#include "token.hpp"
+
+// pascal 中的所有关键字。查找使用编译期生成的完美哈希：
+// 哈希时顺带折叠大小写，不分配内存，也没有静态初始化的开销。
+namespace keywords {
+
+struct Keyword {
+    std::string_view name_;
+    TokenType type_;
+};
+
+constexpr Keyword KEYWORDS[] = {
+    {"BEGIN", BEGIN},     {"END", END},         {"PROGRAM", PROGRAM}, {"VAR", VAR},
+    {"DIV", INTEGER_DIV}, {"INTEGER", INTEGER}, {"REAL", REAL},       {"PROCEDURE", PROCEDURE},
+};
+
+constexpr size_t KEYWORD_COUNT = sizeof(KEYWORDS) / sizeof(KEYWORDS[0]);
+constexpr size_t MIN_LENGTH = 3;
+constexpr size_t MAX_LENGTH = 9;
+constexpr uint32_t TABLE_SIZE = 16;  // 2 的幂，不小于关键字个数
+
+// 只看长度以及首、次、末三个字符（均折叠为大写）
+constexpr uint32_t hash(uint32_t seed, std::string_view word) {
+    uint32_t h = static_cast<uint32_t>(word.size());
+    h = h * 31 + static_cast<unsigned char>(foldCase(word[0]));
+    h = h * 31 + static_cast<unsigned char>(foldCase(word[1]));
+    h = h * 31 + static_cast<unsigned char>(foldCase(word[word.size() - 1]));
+    return ((h * seed) >> 16) & (TABLE_SIZE - 1);
+}
+
+// 编译期搜索一个使所有关键字互不冲突的 seed
+constexpr uint32_t findSeed() {
+    for (uint32_t seed = 1; seed < 1000000; seed += 2) {
+        bool used[TABLE_SIZE] = {};
+        bool ok = true;
+        for (const auto &keyword : KEYWORDS) {
+            auto slot = hash(seed, keyword.name_);
+            if (used[slot]) {
+                ok = false;
+                break;
+            }
+            used[slot] = true;
+        }
+        if (ok) {
+            return seed;
+        }
+    }
+    return 0;
+}
+
+constexpr uint32_t SEED = findSeed();
+static_assert(SEED != 0, "no perfect hash seed for the keyword set");
+
+struct Table {
+    // KEYWORDS 的下标，-1 表示空槽
+    int8_t slots_[TABLE_SIZE];
+};
+
+constexpr Table makeTable() {
+    Table table = {};
+    for (auto &slot : table.slots_) {
+        slot = -1;
+    }
+    for (size_t i = 0; i < KEYWORD_COUNT; ++i) {
+        table.slots_[hash(SEED, KEYWORDS[i].name_)] = static_cast<int8_t>(i);
+    }
+    return table;
+}
+
+constexpr Table TABLE = makeTable();
+
+// word 是关键字时写入 type 并返回 true，大小写不敏感
+constexpr bool lookup(std::string_view word, TokenType &type) {
+    if (word.size() < MIN_LENGTH || word.size() > MAX_LENGTH) {
+        return false;
+    }
+    auto index = TABLE.slots_[hash(SEED, word)];
+    if (index < 0) {
+        return false;
+    }
+    const auto &keyword = KEYWORDS[index];
+    if (keyword.name_.size() != word.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < word.size(); ++i) {
+        if (foldCase(word[i]) != keyword.name_[i]) {
+            return false;
+        }
+    }
+    type = keyword.type_;
+    return true;
+}
+
+}  // namespace keywords
+
+#endif
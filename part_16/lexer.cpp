@@ -1,159 +1,209 @@
 #include "lexer.hpp"
 
-#include <algorithm>
+#include <charconv>
 
-static std::string toUpper(std::string str) {
-    std::string ret = std::move(str);
-    std::transform(ret.begin(), ret.end(), ret.begin(), ::toupper);
-    return ret;
-}
+#include "keywords.hpp"
+#include "trace.hpp"
+
+// 字符分类，scan 按当前字符的类别分派
+enum CharClass : uint8_t {
+    CHAR_INVALID,     // 不支持的字符
+    CHAR_SPACE,       // 空白字符
+    CHAR_IDENTIFIER,  // 字母、下划线
+    CHAR_DIGIT,       // 数字
+    CHAR_COLON,       // ":"，可能是 ":="
+    CHAR_COMMENT,     // "{"
+    CHAR_SINGLE,      // 单字符 token
+};
 
-// pascal 中的所有关键字
-const std::unordered_map<std::string, Token> Lexer::reserved_keywords = {
-    {"BEGIN", Token(BEGIN, "BEGIN")},       {"END", Token(END, "END")},
-    {"PROGRAM", Token(PROGRAM, "PROGRAM")}, {"VAR", Token(VAR, "VAR")},
-    {"DIV", Token(INTEGER_DIV, "DIV")},     {"INTEGER", Token(INTEGER, "INTEGER")},
-    {"REAL", Token(REAL, "REAL")},          {"PROCEDURE", Token(PROCEDURE, "PROCEDURE")},
+struct CharTables {
+    CharClass classes_[256] = {};
+    TokenType single_[256] = {};
 };
+
+static constexpr CharTables makeCharTables() {
+    CharTables tables;
+    for (int c = 'a'; c <= 'z'; ++c) {
+        tables.classes_[c] = CHAR_IDENTIFIER;
+        tables.classes_[c - 'a' + 'A'] = CHAR_IDENTIFIER;
+    }
+    tables.classes_['_'] = CHAR_IDENTIFIER;
+    for (int c = '0'; c <= '9'; ++c) {
+        tables.classes_[c] = CHAR_DIGIT;
+    }
+    for (int c : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+        tables.classes_[c] = CHAR_SPACE;
+    }
+    tables.classes_[':'] = CHAR_COLON;
+    tables.classes_['{'] = CHAR_COMMENT;
+    const std::pair<char, TokenType> singles[] = {
+        {',', COMMA}, {';', SEMI}, {'.', DOT},       {'+', PLUS}, {'-', MINUS},
+        {'*', MUL},   {'/', FLOAT_DIV}, {'(', LP}, {')', RP},
+    };
+    for (const auto &[c, type] : singles) {
+        tables.classes_[static_cast<unsigned char>(c)] = CHAR_SINGLE;
+        tables.single_[static_cast<unsigned char>(c)] = type;
+    }
+    return tables;
+}
+
+static constexpr CharTables char_tables = makeCharTables();
+
+static inline CharClass charClass(char c) {
+    return char_tables.classes_[static_cast<unsigned char>(c)];
+}
+
 // 更新 current char
 void Lexer::advance(unsigned int step) {
-    if (current_char_ == '\n') {
-        lineno_ += 1;
-        column_ = 0;
-    }
-    pos_ += step;
-    if (pos_ >= text_.size()) {
-        current_char_ = INVALID_CHAR;
-    } else {
-        current_char_ = text_[pos_];
-        column_ += 1;
+    moveTo(pos_ + step);
+}
+
+void Lexer::moveTo(size_t new_pos) {
+    pos_ = new_pos;
+    current_char_ = pos_ < text_.size() ? text_[pos_] : INVALID_CHAR;
+}
+
+void Lexer::seek(size_t pos, bool in_comment) {
+    moveTo(pos);
+    if (in_comment) {
+        skipComment();
     }
 }
 
 void Lexer::skipComment() {
-    while (current_char_ != '}') {
-        advance();
+    auto *end = text_.data() + text_.size();
+    auto *brace = findCommentEnd(text_.data() + pos_, end);
+    moveTo(static_cast<size_t>(brace - text_.data()));
+    if (current_char_ != '}') {
+        throwError("unterminated comment");
     }
     advance();  // 跳过最后的花括号
 }
 
 // 跳过空白字符
 void Lexer::skipWhitespace() {
-    while (current_char_ != INVALID_CHAR && isspace(current_char_)) {
-        advance();
-    }
+    auto *end = text_.data() + text_.size();
+    auto *stop = skipSpaces(text_.data() + pos_, end);
+    moveTo(static_cast<size_t>(stop - text_.data()));
 }
 
 Token Lexer::id() {
-    std::string result = "";
+    auto start = pos_;
     // 数字、字母、下划线
-    while (isalnum(current_char_) || '_' == current_char_) {
-        result += current_char_;
-        advance();
+    auto stop = pos_ + 1;
+    while (stop < text_.size() && (charClass(text_[stop]) == CHAR_IDENTIFIER || charClass(text_[stop]) == CHAR_DIGIT)) {
+        ++stop;
+    }
+    if (stop - start > Token::MAX_LENGTH) {
+        throwError("identifier too long");
     }
+    moveTo(stop);
+    auto result = text_.substr(start, pos_ - start);
     // 大小写不敏感
-    result = toUpper(result);
-    auto it = reserved_keywords.find(result);
-    if (it != reserved_keywords.end()) {
-        return it->second;
+    TokenType type = ID;
+    if (keywords::lookup(result, type)) {
+        return Token(type, start, result.size());
+    }
+    auto token = Token(ID, start, result.size());
+    token.id_ = intern(start, result.size());
+    return token;
+}
+
+Identifier Lexer::intern(size_t offset, size_t length) {
+    auto name = text_.substr(offset, length);
+    uint32_t hash = static_cast<uint32_t>(length);
+    for (char c : name) {
+        hash = hash * 31 + static_cast<unsigned char>(c);
+    }
+    auto &entry = intern_cache_[hash & (intern_cache_.size() - 1)];
+    if (entry.length_ == length && text_.compare(entry.offset_, length, name) == 0) {
+        return entry.id_;
     }
-    return Token(ID, result, lineno_, column_);
+    entry.offset_ = static_cast<uint32_t>(offset);
+    entry.length_ = static_cast<uint32_t>(length);
+    entry.id_ = identifiers().intern(name);
+    return entry.id_;
 }
 
 Token Lexer::number() {
-    std::string result = "";
-    while (current_char_ != INVALID_CHAR && isdigit(current_char_)) {
-        result += current_char_;
-        advance();
-    }
-    if (current_char_ == '.') {
-        result += current_char_;
-        advance();
-
-        while (current_char_ != INVALID_CHAR && isdigit(current_char_)) {
-            result += current_char_;
-            advance();
-        }
-        return Token(REAL_CONST, std::stof(result), lineno_, column_);
+    auto start = pos_;
+    auto stop = skipDigits(pos_);
+    auto type = INTEGER_CONST;
+    if (stop < text_.size() && text_[stop] == '.') {
+        type = REAL_CONST;
+        stop = skipDigits(stop + 1);
+    }
+    // 直接在源码上转换：不分配内存，不受 locale 影响，溢出时报错而不是抛出 std::out_of_range
+    auto token = Token(type, start, stop - start);
+    auto *first = text_.data() + start;
+    auto *last = text_.data() + stop;
+    std::from_chars_result result;
+    if (type == REAL_CONST) {
+        result = std::from_chars(first, last, token.real_value_);
     } else {
-        return Token(INTEGER_CONST, std::stoi(result), lineno_, column_);
+        result = std::from_chars(first, last, token.value_);
+    }
+    if (result.ec != std::errc() || result.ptr != last || stop - start > Token::MAX_LENGTH) {
+        throwError("numeric literal out of range");
+    }
+    moveTo(stop);
+    return token;
+}
+
+size_t Lexer::skipDigits(size_t pos) const {
+    while (pos < text_.size() && charClass(text_[pos]) == CHAR_DIGIT) {
+        ++pos;
     }
+    return pos;
 }
 
 char Lexer::peek() {
     auto peek_pos = pos_ + 1;
-    if (peek_pos > text_.size() + 1) {
+    if (peek_pos >= text_.size()) {
         return INVALID_CHAR;
     } else {
         return text_[peek_pos];
     }
 }
 
-// 一个简单的词法分析器（lexer）
 Token Lexer::getNextToken() {
+    auto token = scan();
+    TRACE(TRACE_LEXER, TRACE_DEBUG, toString(token, *source_));
+    return token;
+}
+
+// 按字符类别查表分派
+Token Lexer::scan() {
     while (current_char_ != INVALID_CHAR) {
-        if (isspace(current_char_)) {
-            skipWhitespace();
-            continue;
-        }
-        if (current_char_ == '{') {
-            advance();
-            skipComment();
-            continue;
-        }
-        if (isalpha(current_char_) || '_' == current_char_) {
-            return id();
-        }
-        if (current_char_ == ':' && peek() == '=') {
-            advance(2);
-            return Token(ASSIGN, ":=", lineno_, column_);
-        }
-        // COLON 必须在 ASSIGN 之后判断
-        if (current_char_ == ':') {
-            advance();
-            return Token(COLON, ":", lineno_, column_);
+        switch (charClass(current_char_)) {
+            case CHAR_SPACE:
+                skipWhitespace();
+                continue;
+            case CHAR_COMMENT:
+                advance();
+                skipComment();
+                continue;
+            case CHAR_IDENTIFIER:
+                return id();
+            case CHAR_DIGIT:
+                return number();
+            case CHAR_COLON:
+                if (peek() == '=') {
+                    auto start = pos_;
+                    advance(2);
+                    return Token(ASSIGN, start, 2);
+                }
+                // COLON 必须在 ASSIGN 之后判断
+                advance();
+                return Token(COLON, pos_ - 1, 1);
+            case CHAR_SINGLE: {
+                auto type = char_tables.single_[static_cast<unsigned char>(current_char_)];
+                advance();
+                return Token(type, pos_ - 1, 1);
+            }
+            default:
+                throwError(std::string("Syntax error: not suport char ") + (current_char_));
         }
-        if (current_char_ == ',') {
-            advance();
-            return Token(COMMA, ",", lineno_, column_);
-        }
-        if (current_char_ == ';') {
-            advance();
-            return Token(SEMI, ";", lineno_, column_);
-        }
-        if (current_char_ == '.') {
-            advance();
-            return Token(DOT, ".", lineno_, column_);
-        }
-        if (isdigit(current_char_)) {
-            return number();
-        }
-        if (current_char_ == '+') {
-            advance();
-            return Token(PLUS, "+", lineno_, column_);
-        }
-        if (current_char_ == '-') {
-            advance();
-            return Token(MINUS, "-", lineno_, column_);
-        }
-        if (current_char_ == '*') {
-            advance();
-            return Token(MUL, "*", lineno_, column_);
-        }
-        if (current_char_ == '/') {
-            advance();
-            return Token(FLOAT_DIV, "/", lineno_, column_);
-        }
-        if (current_char_ == '(') {
-            advance();
-            return Token(LP, "(", lineno_, column_);
-        }
-        if (current_char_ == ')') {
-            advance();
-            return Token(RP, ")", lineno_, column_);
-        }
-
-        throwError(std::string("Syntax error: not suport char ") + (current_char_));
     }
-    return Token(END_OF_FILE, "EOF");
-}
\ No newline at end of file
+    return Token(END_OF_FILE, text_.size(), 0);
+}
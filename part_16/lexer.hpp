@@ -1,35 +1,65 @@
 #ifndef LEXER_HPP
 #define LEXER_HPP
 
+#include <array>
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
+#include "arena.hpp"
 #include "ast.hpp"
 #include "error.hpp"
+#include "simd_scan.hpp"
+#include "source.hpp"
 #include "token.hpp"
 
 class Lexer {
    public:
-    explicit Lexer(std::string text) : text_(std::move(text)) {
+    explicit Lexer(std::shared_ptr<const Source> source, std::shared_ptr<Arena> arena = std::make_shared<Arena>())
+        : source_(std::move(source)), text_(source_->text()), arena_(std::move(arena)) {
+        // Token 只有 32 位的偏移
+        if (text_.size() > UINT32_MAX) {
+            throw LexerError("source larger than 4 GiB is not supported");
+        }
         pos_ = 0;
-        current_char_ = text_[pos_];
+        current_char_ = text_.empty() ? INVALID_CHAR : text_[pos_];
     }
 
+    explicit Lexer(std::string text, std::shared_ptr<Arena> arena = std::make_shared<Arena>())
+        : Lexer(std::make_shared<const Source>(std::move(text)), std::move(arena)) {}
+
     char current_char() { return current_char_; }
 
+    // 本次编译的 AST 以及标识符都分配在这个 Arena 中
+    const std::shared_ptr<Arena> &arena() const { return arena_; }
+
+    const std::shared_ptr<const Source> &source() const { return source_; }
+
+    // 从 pos 处继续分析；in_comment 表示 pos 位于注释之中，先跳到注释结尾。用于并行词法分析
+    void seek(size_t pos, bool in_comment);
+
    private:
-    static const std::unordered_map<std::string, Token> reserved_keywords;
-    std::string text_;
+    // Lexer 可以被廉价地复制：源码只通过 shared_ptr 共享，Token 只记录在 text_ 中的偏移
+    std::shared_ptr<const Source> source_;
+    std::string_view text_;
+    std::shared_ptr<Arena> arena_;
+    // 只记录偏移，行号、列号在报错时由 Source 换算
     size_t pos_ = 0;
     char current_char_;
-    int lineno_ = 1;
-    int column_ = 1;
+
+    // 同一拼写的标识符会反复出现，先查这个直接映射的小缓存，命中时不必访问加锁的驻留池
+    struct InternCacheEntry {
+        uint32_t offset_ = 0;
+        uint32_t length_ = 0;
+        Identifier id_ = NO_IDENTIFIER;
+    };
+    std::array<InternCacheEntry, 256> intern_cache_;
 
     inline void throwError(const std::string &msg) {
-        std::string s = "Lexer error on '" + std::string(1, current_char_) + "' line: " + std::to_string(lineno_) +
-                        " column: " + std::to_string(column_);
+        auto position = source_->position(pos_);
+        std::string s = "Lexer error on '" + std::string(1, current_char_) + "' line: " +
+                        std::to_string(position.lineno_) + " column: " + std::to_string(position.column_) + ": " + msg;
 
         throw LexerError(s);
     }
@@ -37,6 +67,11 @@ class Lexer {
     // 更新 current char
     inline void advance(unsigned int step = 1);
 
+    // 一次前进到 new_pos
+    inline void moveTo(size_t new_pos);
+
+    Identifier intern(size_t offset, size_t length);
+
     // 跳过注释
     void skipComment();
 
@@ -48,8 +83,13 @@ class Lexer {
     // 从输入中获取一个实数或者整数（可能有多位）
     Token number();
 
+    // 返回 pos 之后第一个非数字字符的位置
+    size_t skipDigits(size_t pos) const;
+
     char peek();
 
+    Token scan();
+
    public:
     // 一个简单的词法分析器（lexer）
     Token getNextToken();
@@ -39,12 +39,63 @@
 
 //             variable : ID
 
+#include <algorithm>
+#include <optional>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include "ast_cache.hpp"
+#include "compiler.hpp"
+#include "flat_ast.hpp"
+#include "flat_interpreter.hpp"
+#include "flat_semantic_analyzer.hpp"
 #include "interpreter.hpp"
 #include "lexer.hpp"
 #include "parser.hpp"
+#include "phase_stats.hpp"
+#include "program.hpp"
+#include "s2s_compiler.hpp"
 #include "semantic_analyzer.hpp"
+#include "source.hpp"
+#include "token_pipeline.hpp"
+#include "token_stream.hpp"
+#include "trace.hpp"
+#include "vm.hpp"
+
+static const char *DEFAULT_PROGRAM = R"(
+program Main;
+var
+   a : integer;
+
+begin { Main }
+   a := b;  { semantic error }
+end.  { Main }
+    )";
+
+static void usage(const char *name) {
+    std::cerr << "usage: " << name << " [--engine=tree|vm|flat|s2s] [--dump-bytecode] [--stats]" << std::endl
+              << "       [--pre-lex[=threads] | --pipeline] [--max-depth=N]" << std::endl
+              << "       [--lazy | --parallel-parse[=threads]] [--cache-dir=DIR (with --engine=flat)]" << std::endl
+              << "       [--parallel-check[=threads] (without --engine=flat)]" << std::endl
+              << "       [--trace=CATEGORY[:debug],... (lexer, parser, semantic, interpreter, all)]" << std::endl
+              << "       [file.pas | -]" << std::endl
+              << "--engine=vm keeps each variable in one of 65536 registers" << std::endl;
+}
 
-int main() {
+// 流水线中词法分析有多少时间被语法分析掩盖：Parser 等待 token 的时间没有重叠
+static std::string describeOverlap(const TokenPipeline::Stats &stats) {
+    auto hidden = std::max(0.0, stats.lex_seconds_ - stats.consumer_wait_seconds_);
+    auto overlap = stats.lex_seconds_ > 0 ? hidden / stats.lex_seconds_ * 100 : 0.0;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3) << "pipeline: lexer busy " << stats.lex_seconds_ * 1e3
+        << " ms, lexer blocked " << stats.lexer_wait_seconds_ * 1e3 << " ms, parser starved "
+        << stats.consumer_wait_seconds_ * 1e3 << " ms, overlap " << std::setprecision(1) << overlap << "%";
+    return out.str();
+}
+
+int main(int argc, char *argv[]) {
     // std::string text;
     // std::cout << "calc> ";
     // while (getline(std::cin, text)) {
@@ -58,32 +109,174 @@ int main() {
     //     std::cout << "calc> ";
     // }
 
-    auto lexer = Lexer(R"(
-program Main;
-var
-   a : integer;
+    std::string engine = "tree";
+    std::string path;
+    bool dump_bytecode = false;
+    bool stats = false;
+    // 0 表示边分析边获取 token；否则先用这么多线程把整个源码分析成 TokenStream
+    unsigned pre_lex_threads = 0;
+    // Lexer 在另一个线程上与 Parser 同时进行
+    bool pipeline = false;
+    size_t max_depth = Parser::DEFAULT_MAX_DEPTH;
+    // 过程体在第一次用到时才建立 AST
+    bool lazy = false;
+    // 0 表示不并行；否则用这么多线程同时建立各个过程体（-1 表示硬件线程数）
+    int parse_threads = 0;
+    // 0 表示不并行；否则用这么多线程同时检查各个过程体（-1 表示硬件线程数）
+    int check_threads = 0;
+    // 非空时在这个目录中缓存通过语义分析的扁平 AST
+    std::string cache_dir;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--engine=", 9) == 0) {
+            engine = argv[i] + 9;
+        } else if (std::strcmp(argv[i], "--dump-bytecode") == 0) {
+            dump_bytecode = true;
+        } else if (std::strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+        } else if (std::strcmp(argv[i], "--pre-lex") == 0) {
+            pre_lex_threads = 1;
+        } else if (std::strncmp(argv[i], "--pre-lex=", 10) == 0) {
+            pre_lex_threads = static_cast<unsigned>(std::max(1, std::atoi(argv[i] + 10)));
+        } else if (std::strcmp(argv[i], "--pipeline") == 0) {
+            pipeline = true;
+        } else if (std::strncmp(argv[i], "--max-depth=", 12) == 0) {
+            max_depth = static_cast<size_t>(std::max(1LL, std::atoll(argv[i] + 12)));
+        } else if (std::strcmp(argv[i], "--lazy") == 0) {
+            lazy = true;
+        } else if (std::strcmp(argv[i], "--parallel-parse") == 0) {
+            parse_threads = -1;
+        } else if (std::strncmp(argv[i], "--parallel-parse=", 17) == 0) {
+            parse_threads = std::max(1, std::atoi(argv[i] + 17));
+        } else if (std::strcmp(argv[i], "--parallel-check") == 0) {
+            check_threads = -1;
+        } else if (std::strncmp(argv[i], "--parallel-check=", 17) == 0) {
+            check_threads = std::max(1, std::atoi(argv[i] + 17));
+        } else if (std::strncmp(argv[i], "--cache-dir=", 12) == 0) {
+            cache_dir = argv[i] + 12;
+        } else if (std::strncmp(argv[i], "--trace=", 8) == 0) {
+            // 跟踪输出写到 stderr
+            if (!trace::configure(argv[i] + 8)) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            path = argv[i];
+        }
+    }
+    if ((engine != "tree" && engine != "vm" && engine != "flat" && engine != "s2s") || (pipeline && pre_lex_threads != 0) ||
+        (lazy && parse_threads != 0) || (!cache_dir.empty() && engine != "flat") || (check_threads != 0 && engine == "flat")) {
+        usage(argv[0]);
+        return 2;
+    }
 
-begin { Main }
-   a := b;  { semantic error }
-end.  { Main }
-    )");
+    PhaseStats phases;
+    try {
+        // 源文件直接映射到内存，词法分析在映射上进行，不再复制一份
+        phases.start();
+        auto source = path.empty() ? std::make_shared<const Source>(DEFAULT_PROGRAM) : Source::fromFile(path);
+        phases.stop(source->mapped() ? "load/mmap" : "load/read");
 
-    auto parser = Parser(lexer);
-    auto sematic_analyzer = std::make_shared<SemanticAnalyzer>(parser);
-    sematic_analyzer->check();
-    // sematic_analyzer->print();
+        auto executeFlat = [&](const FlatAST &ast) {
+            FlatInterpreter interpreter(ast);
+            interpreter.interpret();
+            phases.stop("execute");
+            interpreter.printGlobalScope();
+        };
 
-    // auto interpreter = std::make_shared<Interpreter>(parser);
-    // interpreter->interpret();
-    // interpreter->printGlobalScope();
-    // interpreter->printSymbolTable();
+        // 缓存命中时直接执行映射进来的扁平 AST，跳过词法、语法和语义分析
+        std::optional<AstCache> cache;
+        std::optional<FlatAST> cached;
+        if (!cache_dir.empty()) {
+            cache.emplace(cache_dir);
+            cached = cache->load(source);
+            phases.stop(cached ? "cache hit" : "cache miss");
+        }
+        if (cached) {
+            executeFlat(*cached);
+        } else {
+            std::shared_ptr<TokenPipeline> token_pipeline;
+            if (pipeline) {
+                token_pipeline = std::make_shared<TokenPipeline>(source);
+            }
+            auto parser = pipeline              ? Parser(token_pipeline)
+                          : pre_lex_threads == 0 ? Parser(Lexer(source))
+                                                 : Parser(TokenStream::lex(source, pre_lex_threads));
+            if (pre_lex_threads != 0) {
+                phases.stop("lex");
+            }
+            parser.setMaxDepth(max_depth);
+            parser.setLazyBodies(lazy);
+            // 只分析一次，之后各遍共享同一个 program
+            auto program = parse_threads == 0 ? ParsedProgram::parse(parser)
+                                              : ParsedProgram::parseParallel(parser, parse_threads < 0 ? 0 : parse_threads);
+            phases.stop(pipeline ? "lex+parse" : "parse");
+            if (pipeline) {
+                phases.note(describeOverlap(token_pipeline->stats()));
+            }
+
+            if (engine == "flat") {
+                auto ast = flatten(*program);
+                FlatSemanticAnalyzer(ast).check();
+                phases.stop("analyze");
+                if (cache) {
+                    // 写缓存失败不影响本次执行
+                    try {
+                        cache->store(ast);
+                    } catch (const std::exception &e) {
+                        std::cerr << "warning: " << e.what() << std::endl;
+                    }
+                    phases.stop("cache store");
+                }
+                executeFlat(ast);
+            } else {
+                auto sematic_analyzer = std::make_shared<SemanticAnalyzer>(program);
+                if (check_threads == 0) {
+                    sematic_analyzer->check();
+                } else {
+                    sematic_analyzer->checkParallel(check_threads < 0 ? 0 : check_threads);
+                }
+                // sematic_analyzer->print();
+                phases.stop("analyze");
+
+                if (engine == "s2s") {
+                    auto output = SourceToSourceCompiler(program).compile();
+                    phases.stop("translate");
+                    std::cout << output;
+                } else if (engine == "vm") {
+                    auto bytecode = std::make_shared<BytecodeCompiler>()->compile(program->root());
+                    phases.stop("compile");
+                    if (dump_bytecode) {
+                        std::cout << bytecode << std::endl;
+                    }
+                    VM vm(std::move(bytecode));
+                    vm.run();
+                    phases.stop("execute");
+                    vm.printGlobalScope();
+                } else {
+                    auto interpreter = std::make_shared<Interpreter>(program);
+                    interpreter->interpret();
+                    phases.stop("execute");
+                    interpreter->printGlobalScope();
+                }
+            }
+        }
+    } catch (const std::exception &e) {
+        // 先写出出错之前的跟踪
+        trace::flush();
+        std::cerr << e.what() << std::endl;
+        if (stats) {
+            phases.report(std::cerr);
+        }
+        return 1;
+    }
+    trace::flush();
+    if (stats) {
+        phases.report(std::cerr);
+    }
 
-    // std::cout << lexer.getNextToken() << std::endl;
-    // std::cout << lexer.getNextToken() << std::endl;
-    // std::cout << lexer.getNextToken() << std::endl;
-    // std::cout << lexer.getNextToken() << std::endl;
-    // std::cout << lexer.getNextToken() << std::endl;
-    // std::cout << lexer.getNextToken() << std::endl;
     // std::cout << lexer.getNextToken() << std::endl;
     // std::cout << lexer.getNextToken() << std::endl;
 
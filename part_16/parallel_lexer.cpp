@@ -0,0 +1,157 @@
+#include "parallel_lexer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <thread>
+
+#include "lexer.hpp"
+
+namespace {
+
+// 小于这个大小的块不值得单独起一个线程
+constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+// 猜测状态时最多向前查看的字节数
+constexpr size_t GUESS_WINDOW = 64 * 1024;
+
+inline bool isSpace(char c) {
+    return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+}
+
+struct Chunk {
+    size_t begin_ = 0;
+    size_t end_ = 0;
+    bool in_comment_ = false;
+    // 分析得到的第一个 token 的偏移（可能已经越过 end_），用于判断起点是否正确；
+    // 在得到第一个 token 之前出错时为 SIZE_MAX
+    size_t first_ = SIZE_MAX;
+    // 越过 end_ 后的第一个 token 的偏移，即下一块真正的起点
+    size_t next_ = 0;
+    std::vector<Token> tokens_;
+    std::exception_ptr error_;
+};
+
+// 注释不能嵌套，注释外也不会出现 '}'，所以 pos 之前最近的花括号决定了 pos 是否在注释中；
+// 窗口内找不到花括号时猜测不在注释中
+bool guessInComment(std::string_view text, size_t pos) {
+    auto stop = pos > GUESS_WINDOW ? pos - GUESS_WINDOW : 0;
+    while (pos > stop) {
+        --pos;
+        if (text[pos] == '{') {
+            return true;
+        }
+        if (text[pos] == '}') {
+            return false;
+        }
+    }
+    return false;
+}
+
+// 分析 [begin, end) 中开始的 token
+void lexChunk(const std::shared_ptr<const Source> &source, Chunk &chunk) {
+    chunk.tokens_.clear();
+    chunk.error_ = nullptr;
+    chunk.first_ = SIZE_MAX;
+    try {
+        // 按平均每个 token 约 8 字节预留，避免反复扩容
+        if (chunk.end_ > chunk.begin_) {
+            chunk.tokens_.reserve((chunk.end_ - chunk.begin_) / 8);
+        }
+        auto lexer = Lexer(source);
+        lexer.seek(chunk.begin_, chunk.in_comment_);
+        auto token = lexer.getNextToken();
+        chunk.first_ = token.offset_;
+        while (token.type_ != END_OF_FILE && token.offset_ < chunk.end_) {
+            chunk.tokens_.push_back(token);
+            token = lexer.getNextToken();
+        }
+        chunk.next_ = token.offset_;
+    } catch (...) {
+        chunk.error_ = std::current_exception();
+    }
+}
+
+// 在 pos 之后找一个空白字符作为块边界：token 不会跨越空白字符
+size_t findBoundary(std::string_view text, size_t pos) {
+    while (pos < text.size() && !isSpace(text[pos])) {
+        ++pos;
+    }
+    return pos;
+}
+
+}  // namespace
+
+std::vector<Token> lexParallel(const std::shared_ptr<const Source> &source, unsigned threads) {
+    auto text = source->text();
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    auto chunk_count = std::max<size_t>(1, std::min<size_t>(threads, text.size() / MIN_CHUNK_SIZE));
+
+    std::vector<Chunk> chunks;
+    size_t begin = 0;
+    for (size_t i = 1; i <= chunk_count && begin < text.size(); ++i) {
+        auto end = i == chunk_count ? text.size() : findBoundary(text, text.size() / chunk_count * i);
+        if (end <= begin) {
+            continue;
+        }
+        Chunk chunk;
+        chunk.begin_ = begin;
+        chunk.end_ = end;
+        chunk.in_comment_ = begin != 0 && guessInComment(text, begin);
+        chunks.push_back(std::move(chunk));
+        begin = end;
+    }
+    if (chunks.empty()) {
+        chunks.emplace_back();
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunks.size(); ++i) {
+        workers.emplace_back(lexChunk, std::cref(source), std::ref(chunks[i]));
+    }
+    lexChunk(source, chunks[0]);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // 按顺序检查各块的起点，猜错的块在当前线程上重新分析。第一块从真正的起点开始，无需检查
+    size_t next = chunks[0].first_;
+    size_t total = 0;
+    for (auto &chunk : chunks) {
+        if (chunk.first_ != next) {
+            chunk.begin_ = next;
+            chunk.in_comment_ = false;
+            lexChunk(source, chunk);
+        }
+        if (chunk.error_) {
+            std::rethrow_exception(chunk.error_);
+        }
+        total += chunk.tokens_.size();
+        next = chunk.next_;
+    }
+
+    std::vector<Token> tokens;
+    if (chunks.size() == 1) {
+        tokens = std::move(chunks[0].tokens_);
+    } else {
+        // 拼接本身也是并行的：每块复制到结果中各自的位置
+        tokens.resize(total);
+        workers.clear();
+        size_t start = 0;
+        for (auto &chunk : chunks) {
+            auto out = tokens.data() + start;
+            start += chunk.tokens_.size();
+            workers.emplace_back([&chunk, out] {
+                std::copy(chunk.tokens_.begin(), chunk.tokens_.end(), out);
+                std::vector<Token>().swap(chunk.tokens_);
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+    tokens.emplace_back(END_OF_FILE, text.size(), 0);
+    return tokens;
+}
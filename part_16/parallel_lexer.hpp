@@ -0,0 +1,18 @@
+#ifndef PARALLEL_LEXER_HPP_
+#define PARALLEL_LEXER_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "source.hpp"
+#include "token.hpp"
+
+// 并行词法分析：把源码按空白字符切成若干块，每块在各自的线程上从猜测的状态（是否位于 { } 注释中）
+// 开始分析，然后按顺序拼接。前一块越过边界后得到的第一个 token 就是后一块真正的起点，
+// 起点对不上说明猜错了，从真正的起点重新分析这一块。
+// 结果与逐个调用 Lexer::getNextToken() 完全相同，最后一个 token 为 END_OF_FILE；
+// 错误也与顺序分析一致，只抛出真正会遇到的第一个错误。
+// threads 为 0 时使用硬件线程数。
+std::vector<Token> lexParallel(const std::shared_ptr<const Source> &source, unsigned threads = 0);
+
+#endif
@@ -1,109 +1,184 @@
 #include "parser.hpp"
 
+#include <array>
+
+#include "trace.hpp"
+
 #define THROW_ERROR throw std::runtime_error(std::string(__FILE__) + ":" + std::to_string(__LINE__) + ": Ivalid syntax")
 
-std::shared_ptr<ASTNode> Parser::parse() {
+namespace {
+
+// 中缀运算符的规则：绑定力越大结合得越紧，0 表示不是中缀运算符；make_ 建立对应的节点
+struct InfixRule {
+    uint8_t power_ = 0;
+    ASTNode *(*make_)(Arena &arena, ASTNode *left, const Token &op, ASTNode *right) = nullptr;
+};
+
+ASTNode *makeBinaryOp(Arena &arena, ASTNode *left, const Token &op, ASTNode *right) {
+    return arena.make<BinaryOpNode>(left, op, right);
+}
+
+constexpr std::array<InfixRule, TOKEN_TYPE_COUNT> makeInfixRules() {
+    std::array<InfixRule, TOKEN_TYPE_COUNT> rules = {};
+    rules[PLUS] = {10, makeBinaryOp};
+    rules[MINUS] = {10, makeBinaryOp};
+    rules[MUL] = {20, makeBinaryOp};
+    rules[INTEGER_DIV] = {20, makeBinaryOp};
+    rules[FLOAT_DIV] = {20, makeBinaryOp};
+    return rules;
+}
+
+// 按 TokenType 查表，新增运算符或优先级只需要在这里加一行
+constexpr std::array<InfixRule, TOKEN_TYPE_COUNT> INFIX_RULES = makeInfixRules();
+
+}  // namespace
+
+ProgramNode *Parser::parse() {
     auto node = program();
-    if (current_token_.type_ != END_OF_FILE) {
+    if (currentType() != END_OF_FILE) {
         THROW_ERROR;
     }
     return node;
 }
 
+BlockNode *Parser::procedureBody() {
+    auto node = block();
+    if (currentType() != SEMI) {
+        throwError(UNEXPECTED_TOKEN, currentToken(), *lexer_.source());
+    }
+    return node;
+}
+
 // program : PROGRAM variable SEMI block DOT
-std::shared_ptr<ProgramNode> Parser::program() {
+ProgramNode *Parser::program() {
     eatToken(PROGRAM);
     auto var_node = variable();
-    auto program_name = var_node->value_;
+    auto program_name = var_node->id_;
     eatToken(SEMI);
     auto block_node = block();
-    auto program_node = std::make_shared<ProgramNode>(program_name, block_node);
+    auto program_node = arena_->make<ProgramNode>(program_name, block_node);
     eatToken(DOT);
     return program_node;
 }
 
-std::shared_ptr<BlockNode> Parser::block() {
+BlockNode *Parser::block() {
     auto declarations_nodes = declaration();
     auto compund_statement_node = compound_statement();
-    auto node = std::make_shared<BlockNode>(declarations_nodes, compund_statement_node);
+    auto node = arena_->make<BlockNode>(arena_->array(declarations_nodes), compund_statement_node);
     return node;
 }
 
 // compound_statement : BEGIN statement_list END
-std::shared_ptr<CompoundNode> Parser::compound_statement() {
+CompoundNode *Parser::compound_statement() {
     eatToken(BEGIN);
     auto nodes = statement_list();
     eatToken(END);
-    auto root = std::make_shared<CompoundNode>(nodes);
+    auto root = arena_->make<CompoundNode>(arena_->array(nodes));
     return root;
 }
 
 // declarations : VAR (variable_delaration SEMI)+
 //              | (PROCEDURE ID (LPPAREN formal_parameter_list RPAREN)? SEMI block SEMI)*
 //              | empty
-std::vector<std::shared_ptr<ASTNode>> Parser::declaration() {
-    std::vector<std::shared_ptr<ASTNode>> declarations;
-    if (current_token_.type_ == VAR) {
+std::vector<ASTNode *> Parser::declaration() {
+    std::vector<ASTNode *> declarations;
+    if (currentType() == VAR) {
         eatToken(VAR);
-        while (current_token_.type_ == ID) {
+        while (currentType() == ID) {
             auto var_decl = variable_declaration();
             declarations.insert(declarations.end(), var_decl.begin(), var_decl.end());
             eatToken(SEMI);
         }
     }
-    while (current_token_.type_ == PROCEDURE) {
+    while (currentType() == PROCEDURE) {
         declarations.emplace_back(procedure_declaration());
     }
     return declarations;
 }
 
 // procedure_declaration: PROCEDURE ID (LPAREN formal_parameter_list RPAREN)? SEMI block SEMI
-std::shared_ptr<ProcedureDecl> Parser::procedure_declaration() {
+ProcedureDecl *Parser::procedure_declaration() {
     eatToken(PROCEDURE);
-    auto proc_name = current_token_.str_;
+    auto proc_name = currentToken().id_;
     eatToken(ID);
-    std::vector<std::shared_ptr<ParamNode>> params;
-    if (current_token_.type_ == LP) {
+    std::vector<ParamNode *> params;
+    if (currentType() == LP) {
         eatToken(LP);
         params = formal_paramter_list();
         eatToken(RP);
     }
     eatToken(SEMI);
-    auto block_node = block();
-    auto proc_decl = std::make_shared<ProcedureDecl>(proc_name, params, block_node);
+    TRACE(TRACE_PARSER, TRACE_INFO,
+          "procedure " << identifiers().name(proc_name) << (lazy_bodies_ ? " (body deferred)" : ""));
+    ProcedureDecl *proc_decl;
+    if (lazy_bodies_) {
+        auto body_offset = currentToken().offset_;
+        proc_decl = arena_->make<ProcedureDecl>(proc_name, arena_->array(params), nullptr, body_offset);
+        deferred_.push_back(proc_decl);
+        skipBlock();
+    } else {
+        auto block_node = block();
+        proc_decl = arena_->make<ProcedureDecl>(proc_name, arena_->array(params), block_node);
+    }
     eatToken(SEMI);
     return proc_decl;
 }
 
+// 声明部分中的每个嵌套过程以及 block 本身各有一个最外层的 BEGIN ... END，
+// 在最外层遇到 PROCEDURE 时多等待一个最外层的 END
+void Parser::skipBlock() {
+    size_t depth = 0;
+    size_t open_blocks = 1;
+    for (;;) {
+        auto type = currentType();
+        if (type == BEGIN) {
+            ++depth;
+        } else if (type == END) {
+            if (depth == 0) {
+                eatToken(BEGIN);
+            }
+            if (--depth == 0 && --open_blocks == 0) {
+                eatToken(END);
+                return;
+            }
+        } else if (type == PROCEDURE && depth == 0) {
+            ++open_blocks;
+        } else if (type == END_OF_FILE) {
+            eatToken(END);
+        }
+        eatToken(type);
+    }
+}
+
 // proccall_statement: ID LPAREN (expr (COMMA expr)*)? RPAREN
-std::shared_ptr<ProcedureCallNode> Parser::proccall_statement() {
-    auto token = current_token_;
-    auto proc_name = current_token_.str_;
+ProcedureCallNode *Parser::proccall_statement() {
+    auto token = currentToken();
+    auto proc_name = currentToken().id_;
     eatToken(ID);
     eatToken(LP);
-    std::vector<std::shared_ptr<ASTNode>> actual_params;
-    if (current_token_.type_ != RP) {
+    std::vector<ASTNode *> actual_params;
+    if (currentType() != RP) {
         actual_params.push_back(expr());
     }
 
-    while (current_token_.type_ == COMMA) {
+    while (currentType() == COMMA) {
         eatToken(COMMA);
         actual_params.push_back(expr());
     }
     eatToken(RP);
 
-    return std::make_shared<ProcedureCallNode>(proc_name, actual_params, token);
+    return arena_->make<ProcedureCallNode>(proc_name, arena_->array(actual_params), token);
 }
 
 // formal_parameter_list : formal_parameters
 //                       | formal_parameters SEMI formal_parameter_list
-std::vector<std::shared_ptr<ParamNode>> Parser::formal_paramter_list() {
-    if (current_token_.type_ != ID) {
+std::vector<ParamNode *> Parser::formal_paramter_list() {
+    if (currentType() != ID) {
         return {};
     }
     auto param_nodes = formal_paramters();
 
-    while (current_token_.type_ == SEMI) {
+    while (currentType() == SEMI) {
         eatToken(SEMI);
         auto remain_params = formal_paramters();
         param_nodes.insert(param_nodes.end(), remain_params.begin(), remain_params.end());
@@ -112,30 +187,30 @@ std::vector<std::shared_ptr<ParamNode>> Parser::formal_paramter_list() {
 }
 
 // formal_parameters : ID (COMMA ID)* COLON type_spec
-std::vector<std::shared_ptr<ParamNode>> Parser::formal_paramters() {
-    std::vector<std::shared_ptr<ParamNode>> param_nodes;
-    std::vector<Token> param_tokens = {current_token_};
+std::vector<ParamNode *> Parser::formal_paramters() {
+    std::vector<ParamNode *> param_nodes;
+    std::vector<Token> param_tokens = {currentToken()};
     eatToken(ID);
-    while (current_token_.type_ == COMMA) {
+    while (currentType() == COMMA) {
         eatToken(COMMA);
-        param_tokens.push_back(current_token_);
+        param_tokens.push_back(currentToken());
         eatToken(ID);
     }
     eatToken(COLON);
     auto type_node = type_spec();
 
     for (const auto &param_token : param_tokens) {
-        param_nodes.emplace_back(std::make_shared<ParamNode>(std::make_shared<VarNode>(param_token), type_node));
+        param_nodes.emplace_back(arena_->make<ParamNode>(arena_->make<VarNode>(param_token), type_node));
     }
     return param_nodes;
 }
 
 // variable_declaration : ID (COMMA ID)* COLON type_spec
-std::vector<std::shared_ptr<VarDeclNode>> Parser::variable_declaration() {
-    std::vector<std::shared_ptr<VarNode>> var_nodes;
+std::vector<VarDeclNode *> Parser::variable_declaration() {
+    std::vector<VarNode *> var_nodes;
     var_nodes.emplace_back(variable());
 
-    while (current_token_.type_ == COMMA) {
+    while (currentType() == COMMA) {
         eatToken(COMMA);
         var_nodes.emplace_back(variable());
     }
@@ -143,36 +218,36 @@ std::vector<std::shared_ptr<VarDeclNode>> Parser::variable_declaration() {
     eatToken(COLON);
 
     auto type_node = type_spec();
-    std::vector<std::shared_ptr<VarDeclNode>> var_declarations;
+    std::vector<VarDeclNode *> var_declarations;
     for (auto &&var_node : var_nodes) {
-        var_declarations.push_back(std::make_shared<VarDeclNode>(var_node, type_node));
+        var_declarations.push_back(arena_->make<VarDeclNode>(var_node, type_node));
     }
     return var_declarations;
 }
 
 // type_spec : INTEGER
 //           | REAL
-std::shared_ptr<TypeNode> Parser::type_spec() {
-    auto token = current_token_;
-    if (current_token_.type_ == INTEGER) {
+TypeNode *Parser::type_spec() {
+    auto token = currentToken();
+    if (currentType() == INTEGER) {
         eatToken(INTEGER);
     } else {
         eatToken(REAL);
     }
-    return std::make_shared<TypeNode>(token);
+    return arena_->make<TypeNode>(token, identifiers().intern(token.text(lexer_.source()->text())));
 }
 
 // statement_list: statement
 //               | statement SEMI statement_list
-std::vector<std::shared_ptr<ASTNode>> Parser::statement_list() {
+std::vector<ASTNode *> Parser::statement_list() {
     auto node = statement();
-    std::vector<std::shared_ptr<ASTNode>> results;
+    std::vector<ASTNode *> results;
     results.push_back(node);
-    while (current_token_.type_ == SEMI) {
+    while (currentType() == SEMI) {
         eatToken(SEMI);
         results.push_back(statement());
     }
-    if (current_token_.type_ == ID) {
+    if (currentType() == ID) {
         THROW_ERROR;
     }
     return results;
@@ -182,12 +257,12 @@ std::vector<std::shared_ptr<ASTNode>> Parser::statement_list() {
 //           | proccall_statement
 //           | assignment_statement
 //           | empty
-std::shared_ptr<ASTNode> Parser::statement() {
-    if (current_token_.type_ == BEGIN) {
+ASTNode *Parser::statement() {
+    if (currentType() == BEGIN) {
         return compound_statement();
-    } else if(current_token_.type_ == ID && lexer_.current_char() == '(') {
+    } else if (currentType() == ID && peekType() == LP) {
         return proccall_statement();
-    }else if (current_token_.type_ == ID) {
+    } else if (currentType() == ID) {
         return assignment_statement();
     } else {
         return empty();
@@ -195,92 +270,116 @@ std::shared_ptr<ASTNode> Parser::statement() {
 }
 
 // assignment_statement : variable ASSIGN expr
-std::shared_ptr<AssignNode> Parser::assignment_statement() {
+AssignNode *Parser::assignment_statement() {
     auto left = variable();
-    auto token = current_token_;
+    auto token = currentToken();
     eatToken(ASSIGN);
     auto right = expr();
-    return std::make_shared<AssignNode>(left->value_, token, right);
+    return arena_->make<AssignNode>(left->id_, token, right);
 }
 
 // variable : ID
-std::shared_ptr<VarNode> Parser::variable() {
-    auto node = std::make_shared<VarNode>(current_token_);
+VarNode *Parser::variable() {
+    auto node = arena_->make<VarNode>(currentToken());
     eatToken(ID);
     return node;
 }
 
 // empty
-std::shared_ptr<NoOpNode> Parser::empty() {
-    return std::make_shared<NoOpNode>();
+NoOpNode *Parser::empty() {
+    return arena_->make<NoOpNode>();
 }
 
 // 确保当前 token 的 type 为指定的 token_type，并且获取下一个 token
 void Parser::eatToken(const TokenType &type) {
-    if (current_token_.type_ == type) {
-        current_token_ = lexer_.getNextToken();
-        return;
+    if (currentType() != type) {
+        throwError(UNEXPECTED_TOKEN, currentToken(), *lexer_.source());
     }
-    throwError(UNEXPECTED_TOKEN, current_token_);
-}
-
-// factor: (PLUS | MINUS) factor | INTEGER_CONST | REAL_CONST | (LP expr RP) | variable
-std::shared_ptr<ASTNode> Parser::factor() {
-    auto token = current_token_;
-    if (token.type_ == PLUS) {
-        eatToken(PLUS);
-        return std::make_shared<UnaryOpNode>(token, factor());
-    } else if (token.type_ == MINUS) {
-        eatToken(MINUS);
-        return std::make_shared<UnaryOpNode>(token, factor());
-    } else if (token.type_ == INTEGER_CONST) {
-        eatToken(INTEGER_CONST);
-        return std::make_shared<NumNode>(token);
-    } else if (token.type_ == REAL_CONST) {
-        eatToken(REAL_CONST);
-        return std::make_shared<NumNode>(token);
-    } else if (token.type_ == LP) {
-        eatToken(LP);
-        auto node = expr();
-        eatToken(RP);
-        return node;
+    if (tokens_) {
+        ++index_;
+    } else if (has_peek_) {
+        current_token_ = peek_token_;
+        has_peek_ = false;
     } else {
-        return variable();
+        current_token_ = nextToken();
     }
-    THROW_ERROR;
-    return nullptr;
 }
 
-// term : factor ((MUL | INTEGER_DIV | FLOAT_DIV) factor)*
-std::shared_ptr<ASTNode> Parser::term() {
-    auto node = factor();
-    while (current_token_.type_ == MUL || current_token_.type_ == INTEGER_DIV || current_token_.type_ == FLOAT_DIV) {
-        auto token = current_token_;
-        if (token.type_ == MUL) {
-            eatToken(MUL);
-        } else if (token.type_ == INTEGER_DIV) {
-            eatToken(INTEGER_DIV);
-        } else if (token.type_ == FLOAT_DIV) {
-            eatToken(FLOAT_DIV);
-        }
-        node = std::make_shared<BinaryOpNode>(node, token, factor());
+TokenType Parser::peekType() {
+    if (tokens_) {
+        return tokens_->type(index_ + 1);
     }
-
-    return node;
+    if (!has_peek_) {
+        peek_token_ = nextToken();
+        has_peek_ = true;
+    }
+    return peek_token_.type_;
 }
 
-// expr : term ((PLUS | MINUS) term)*
-std::shared_ptr<ASTNode> Parser::expr() {
-    auto node = term();
+// 与递归的 Pratt 分析等价，但待定的部分放在显式栈 pending_ 上：递归版本中的每一层调用对应栈中的一项，
+// 其绑定力就是那一层的 min_power。因此任意深的括号嵌套、任意长的运算符链都只占用线性的堆内存。
+ASTNode *Parser::expr() {
+    auto base = pending_.size();
+    auto push = [&](Pending pending) {
+        if (pending_.size() - base >= max_depth_) {
+            throwError(NESTING_TOO_DEEP, currentToken(), *lexer_.source());
+        }
+        pending_.push_back(pending);
+    };
+    for (;;) {
+        // 前缀部分：(PLUS | MINUS | LP)* (INTEGER_CONST | REAL_CONST | variable)
+        ASTNode *node = nullptr;
+        while (node == nullptr) {
+            switch (currentType()) {
+                case PLUS:
+                case MINUS: {
+                    auto token = currentToken();
+                    eatToken(token.type_);
+                    push({Pending::UNARY, PREFIX_POWER, token, nullptr});
+                    break;
+                }
+                case LP: {
+                    auto token = currentToken();
+                    eatToken(LP);
+                    push({Pending::PAREN, 0, token, nullptr});
+                    break;
+                }
+                case INTEGER_CONST:
+                case REAL_CONST: {
+                    auto token = currentToken();
+                    eatToken(token.type_);
+                    node = arena_->make<NumNode>(token);
+                    break;
+                }
+                default:
+                    node = variable();
+                    break;
+            }
+        }
 
-    while (current_token_.type_ == PLUS || current_token_.type_ == MINUS) {
-        auto token = current_token_;
-        if (token.type_ == PLUS) {
-            eatToken(PLUS);
-        } else if (token.type_ == MINUS) {
-            eatToken(MINUS);
+        // 中缀部分：比栈顶结合得更紧的运算符开始新的一项，否则完成栈顶的一项
+        for (;;) {
+            auto min_power = pending_.size() > base ? pending_.back().power_ : 0;
+            auto type = currentType();
+            const auto &rule = INFIX_RULES[type];
+            if (rule.power_ > min_power) {
+                auto token = currentToken();
+                eatToken(type);
+                push({Pending::BINARY, rule.power_, token, node});
+                break;
+            }
+            if (pending_.size() == base) {
+                return node;
+            }
+            auto pending = pending_.back();
+            pending_.pop_back();
+            if (pending.kind_ == Pending::BINARY) {
+                node = INFIX_RULES[pending.op_.type_].make_(*arena_, pending.left_, pending.op_, node);
+            } else if (pending.kind_ == Pending::UNARY) {
+                node = arena_->make<UnaryOpNode>(pending.op_, node);
+            } else {
+                eatToken(RP);
+            }
         }
-        node = std::make_shared<BinaryOpNode>(node, token, term());
     }
-    return node;
-}
\ No newline at end of file
+}
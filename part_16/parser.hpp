@@ -4,83 +4,155 @@
 #include "error.hpp"
 #include "lexer.hpp"
 #include "token.hpp"
+#include "token_pipeline.hpp"
+#include "token_stream.hpp"
 
-static void throwError(ErrorCode error_code, const Token &token) {
-    throw ParserError(error_code, token, "");
+static void throwError(ErrorCode error_code, const Token &token, const Source &source) {
+    throw ParserError(error_code, token, source, "");
 }
 
 class Parser {
    public:
-    explicit Parser(Lexer lexer) : lexer_(lexer) { current_token_ = lexer_.getNextToken(); }
+    // 表达式默认的最大嵌套深度
+    static constexpr size_t DEFAULT_MAX_DEPTH = 1 << 20;
 
-    std::shared_ptr<ASTNode> parse();
+    explicit Parser(Lexer lexer) : lexer_(lexer), arena_(lexer_.arena()) { current_token_ = lexer_.getNextToken(); }
+
+    // 在预先分析好的 token 序列上做语法分析，不再边分析边调用 Lexer
+    explicit Parser(std::shared_ptr<const TokenStream> tokens, std::shared_ptr<Arena> arena = std::make_shared<Arena>())
+        : lexer_(tokens->source(), std::move(arena)), arena_(lexer_.arena()), tokens_(std::move(tokens)) {}
+
+    // 从另一个线程上的 Lexer 取 token，词法分析与语法分析同时进行
+    explicit Parser(std::shared_ptr<TokenPipeline> pipeline, std::shared_ptr<Arena> arena = std::make_shared<Arena>())
+        : lexer_(pipeline->source(), std::move(arena)), arena_(lexer_.arena()), pipeline_(std::move(pipeline)) {
+        current_token_ = pipeline_->next();
+    }
+
+    // 返回的 AST 归 arena() 所有
+    ProgramNode *parse();
+
+    // 在过程体的起点上分析过程体，之后应当是过程声明末尾的 SEMI。用于惰性分析
+    BlockNode *procedureBody();
+
+    const std::shared_ptr<Arena> &arena() const { return arena_; }
+
+    // 表达式中尚未完成的括号、一元运算符以及二元运算符超过 depth 个时报 NESTING_TOO_DEEP。
+    // 分析本身不会因为嵌套过深而栈溢出，这里只是限制内存
+    void setMaxDepth(size_t depth) { max_depth_ = depth; }
+
+    size_t maxDepth() const { return max_depth_; }
+
+    // 惰性分析过程体：只按 BEGIN、END 配对跳过过程体并记录它的起点，不建立 AST。
+    // 过程体中的语法错误要到建立它的时候才报告
+    void setLazyBodies(bool lazy) { lazy_bodies_ = lazy; }
+
+    // 惰性分析时跳过了过程体的过程，按声明的顺序。parse() 出错时也保留出错之前声明的过程，
+    // 出错的位置在最后一个过程体之中时，这个过程体没有完整地跳过
+    const std::vector<ProcedureDecl *> &deferredProcedures() const { return deferred_; }
+
+    const std::shared_ptr<const Source> &source() const { return lexer_.source(); }
 
    private:
     // program : compund_statement DOT
-    std::shared_ptr<ProgramNode> program();
+    ProgramNode *program();
 
     // block : declarations compund_statement
-    std::shared_ptr<BlockNode> block();
+    BlockNode *block();
 
     // compound_statement : BEGIN statement_list END
-    std::shared_ptr<CompoundNode> compound_statement();
+    CompoundNode *compound_statement();
 
     // declarations : (VAR (variable_delaration SEMI)+)? procedure_declaration*
     //              | empty
-    std::vector<std::shared_ptr<ASTNode>> declaration();
+    std::vector<ASTNode *> declaration();
 
     // procedure_declaration: PROCEDURE ID (LPAREN formal_parameter_list RPAREN)? SEMI block SEMI
-    std::shared_ptr<ProcedureDecl> procedure_declaration();
+    ProcedureDecl *procedure_declaration();
+
+    // 跳过一个 block，不建立 AST
+    void skipBlock();
 
     // proccall_statement: ID LPAREN (expr (COMMA expr)*)? RPAREN
-    std::shared_ptr<ProcedureCallNode> proccall_statement();
+    ProcedureCallNode *proccall_statement();
 
     // formal_parameter_list : formal_parameters
     //                       | formal_parameters SEMI formal_parameter_list
-    std::vector<std::shared_ptr<ParamNode>> formal_paramter_list();
+    std::vector<ParamNode *> formal_paramter_list();
 
     // formal_parameters : ID (COMMA ID)* COLON type_spec
-    std::vector<std::shared_ptr<ParamNode>> formal_paramters();
+    std::vector<ParamNode *> formal_paramters();
 
     // variable_declaration : ID (COMMA ID)* COLON type_spec
-    std::vector<std::shared_ptr<VarDeclNode>> variable_declaration();
+    std::vector<VarDeclNode *> variable_declaration();
 
     // type_spec : INTEGER
     //           | REAL
-    std::shared_ptr<TypeNode> type_spec();
+    TypeNode *type_spec();
 
     // statement_list: statement
     //               | statement SEMI statement_list
-    std::vector<std::shared_ptr<ASTNode>> statement_list();
+    std::vector<ASTNode *> statement_list();
 
     // statement : compound_statement
+    //           | proccall_statement
     //           | assignment_statement
     //           | empty
-    std::shared_ptr<ASTNode> statement();
+    ASTNode *statement();
 
     // assignment_statement : variable ASSIGN expr
-    std::shared_ptr<AssignNode> assignment_statement();
+    AssignNode *assignment_statement();
 
     // variable : ID
-    std::shared_ptr<VarNode> variable();
+    VarNode *variable();
 
     // empty
-    std::shared_ptr<NoOpNode> empty();
+    NoOpNode *empty();
 
     // 确保当前 token 的 type 为指定的 token_type，并且获取下一个 token
     void eatToken(const TokenType &type);
 
-    // factor: (PLUS | MINUS) factor | INTEGER | (LP expr RP) | variable
-    std::shared_ptr<ASTNode> factor();
+    TokenType currentType() const { return tokens_ ? tokens_->type(index_) : current_token_.type_; }
+
+    Token currentToken() const { return tokens_ ? tokens_->token(index_) : current_token_; }
+
+    // 当前 token 之后的一个 token 的类型
+    TokenType peekType();
+
+    // 逐个获取 token 时的下一个 token
+    Token nextToken() { return pipeline_ ? pipeline_->next() : lexer_.getNextToken(); }
 
-    // term: factor ((MUL | DIV) factor)*
-    std::shared_ptr<ASTNode> term();
+    // 一元运算符的操作数只能是更紧的前缀部分，例如 -a * b 为 (-a) * b
+    static constexpr uint8_t PREFIX_POWER = 30;
 
-    // expr : term ((PLUS | MINUS) term)*
-    std::shared_ptr<ASTNode> expr();
+    // expr : prefix (infix_op prefix)*
+    // prefix : (PLUS | MINUS) prefix | INTEGER_CONST | REAL_CONST | (LP expr RP) | variable
+    // Pratt 分析，不递归：运算符的优先级以及对应的节点按 TokenType 查表（见 parser.cpp 中的 INFIX_RULES），
+    // 尚未完成的部分放在 pending_ 上
+    ASTNode *expr();
 
     Lexer lexer_;
+    std::shared_ptr<Arena> arena_;
+    // 有 tokens_ 时按下标 index_ 遍历它；否则逐个从 pipeline_ 或 lexer_ 获取，向前查看的 token 暂存在 peek_token_ 中
+    std::shared_ptr<const TokenStream> tokens_;
+    std::shared_ptr<TokenPipeline> pipeline_;
+    size_t index_ = 0;
     Token current_token_;
+    Token peek_token_;
+    bool has_peek_ = false;
+
+    // 表达式分析的显式栈中的一项：等待操作数的一元运算符、等待右括号的左括号，
+    // 或者已有左操作数、等待右操作数的二元运算符。power_ 为其右侧允许的最小绑定力
+    struct Pending {
+        enum Kind : uint8_t { UNARY, PAREN, BINARY };
+        Kind kind_;
+        uint8_t power_;
+        Token op_;
+        ASTNode *left_;
+    };
+    std::vector<Pending> pending_;
+    size_t max_depth_ = DEFAULT_MAX_DEPTH;
+    bool lazy_bodies_ = false;
+    std::vector<ProcedureDecl *> deferred_;
 };
 
 #endif
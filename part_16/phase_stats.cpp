@@ -0,0 +1,56 @@
+#include "phase_stats.hpp"
+
+#include <cstdio>
+#include <iomanip>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+size_t residentMemory() {
+#if defined(__linux__)
+    if (FILE *file = std::fopen("/proc/self/statm", "r")) {
+        unsigned long size = 0;
+        unsigned long resident = 0;
+        int n = std::fscanf(file, "%lu %lu", &size, &resident);
+        std::fclose(file);
+        if (n == 2) {
+            return static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        }
+    }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    // 退化为峰值常驻内存
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+        return static_cast<size_t>(usage.ru_maxrss);
+#else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+#endif
+    return 0;
+}
+
+void PhaseStats::stop(std::string name) {
+    auto seconds = std::chrono::duration<double>(Clock::now() - start_).count();
+    phases_.push_back({std::move(name), seconds, residentMemory()});
+    start_ = Clock::now();
+}
+
+void PhaseStats::report(std::ostream &out) const {
+    out << "PHASES" << std::endl;
+    out << "-----------------------------------" << std::endl;
+    for (const auto &phase : phases_) {
+        out << std::left << std::setw(10) << phase.name_ << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << phase.seconds_ * 1e3 << " ms" << std::setw(12) << phase.resident_ / (1024.0 * 1024.0)
+            << " MiB resident" << std::endl;
+    }
+    out.unsetf(std::ios::fixed);
+    out << std::setprecision(6);
+    for (const auto &note : notes_) {
+        out << note << std::endl;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef PHASE_STATS_HPP_
+#define PHASE_STATS_HPP_
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 当前进程的常驻内存（字节），无法获取时返回 0
+size_t residentMemory();
+
+// 记录编译、执行各阶段的耗时以及阶段结束时的常驻内存
+class PhaseStats {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    // 开始计时下一个阶段
+    void start() { start_ = Clock::now(); }
+
+    // 结束当前阶段
+    void stop(std::string name);
+
+    // 附加说明（例如流水线的重叠程度），在报告末尾原样输出
+    void note(std::string text) { notes_.push_back(std::move(text)); }
+
+    void report(std::ostream &out) const;
+
+   private:
+    struct Phase {
+        std::string name_;
+        double seconds_;
+        size_t resident_;
+    };
+
+    Clock::time_point start_ = Clock::now();
+    std::vector<Phase> phases_;
+    std::vector<std::string> notes_;
+};
+
+#endif
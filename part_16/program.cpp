@@ -0,0 +1,87 @@
+#include "program.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
+#include "trace.hpp"
+
+std::shared_ptr<const ParsedProgram> ParsedProgram::parse(Parser &parser) {
+    auto root = parser.parse();
+    return std::make_shared<const ParsedProgram>(parser.source(), parser.arena(), root, parser.maxDepth());
+}
+
+std::shared_ptr<const ParsedProgram> ParsedProgram::parseParallel(Parser &parser, unsigned threads) {
+    parser.setLazyBodies(true);
+    // 扫描出错时，之前的过程体仍然要建立：其中的错误在源码中更靠前
+    ProgramNode *root = nullptr;
+    std::exception_ptr scan_error;
+    try {
+        root = parser.parse();
+    } catch (...) {
+        scan_error = std::current_exception();
+    }
+    auto program = std::make_shared<ParsedProgram>(parser.source(), parser.arena(), root, parser.maxDepth());
+
+    const auto &procedures = parser.deferredProcedures();
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<size_t>(threads, procedures.size()));
+
+    // 各线程从 next 依次领取过程，过程体大小不一时也能保持均衡
+    std::atomic<size_t> next{0};
+    std::vector<std::exception_ptr> errors(procedures.size());
+    auto work = [&](const std::shared_ptr<Arena> &arena) {
+        for (auto i = next.fetch_add(1); i < procedures.size(); i = next.fetch_add(1)) {
+            try {
+                procedures[i]->block_ = program->parseBody(procedures[i], arena, false);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        program->body_arenas_.push_back(std::make_shared<Arena>());
+    }
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(work, std::cref(program->body_arenas_[i]));
+    }
+    if (threads > 0) {
+        work(program->body_arenas_[0]);
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    // 过程体按声明的顺序排列，也就是源码中的顺序，并且都从扫描出错的位置之前开始
+    for (const auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    if (scan_error) {
+        std::rethrow_exception(scan_error);
+    }
+    return program;
+}
+
+BlockNode *ParsedProgram::body(ProcedureDecl *node) const {
+    std::lock_guard<std::mutex> lock(bodies_mutex_);
+    if (node->block_ == nullptr) {
+        node->block_ = parseBody(node, arena_, true);
+    }
+    return node->block_;
+}
+
+BlockNode *ParsedProgram::parseBody(ProcedureDecl *node, const std::shared_ptr<Arena> &arena, bool lazy) const {
+    TRACE(TRACE_PARSER, TRACE_INFO, "body of " << identifiers().name(node->proc_name_));
+    // 从过程体的第一个 token 开始逐个获取 token
+    auto lexer = Lexer(source_, arena);
+    lexer.seek(node->body_offset_, false);
+    auto parser = Parser(lexer);
+    parser.setMaxDepth(max_depth_);
+    parser.setLazyBodies(lazy);
+    return parser.procedureBody();
+}
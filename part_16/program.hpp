@@ -0,0 +1,59 @@
+#ifndef PROGRAM_HPP_
+#define PROGRAM_HPP_
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "arena.hpp"
+#include "ast.hpp"
+#include "parser.hpp"
+#include "source.hpp"
+
+// 语法分析一次得到的程序：源码、AST 以及持有 AST 的 Arena。
+// 建立之后不再修改，语义分析、解释执行、源到源编译等各遍共享同一个 ParsedProgram，
+// 不再各自重新分析源码。唯一的例外是惰性分析的过程体：它们在第一次通过 body() 访问时才建立，
+// 之后同样不再修改。
+class ParsedProgram {
+   public:
+    ParsedProgram(std::shared_ptr<const Source> source, std::shared_ptr<Arena> arena, ProgramNode *root,
+                  size_t max_depth = Parser::DEFAULT_MAX_DEPTH)
+        : source_(std::move(source)), arena_(std::move(arena)), root_(root), max_depth_(max_depth) {}
+
+    ParsedProgram(const ParsedProgram &) = delete;
+    ParsedProgram &operator=(const ParsedProgram &) = delete;
+
+    // 编译驱动的前端：用 parser 分析整个源码，语法错误在这里抛出
+    static std::shared_ptr<const ParsedProgram> parse(Parser &parser);
+
+    // 并行的前端：parser 先惰性分析、确定各个过程体的范围，之后由 threads 个线程（0 表示硬件线程数）
+    // 同时建立最外层各过程的过程体（连同其中嵌套的过程），每个线程使用自己的 Arena。
+    // 声明的顺序不变；出错时和顺序分析一样，抛出源码中最靠前的错误
+    static std::shared_ptr<const ParsedProgram> parseParallel(Parser &parser, unsigned threads = 0);
+
+    const std::shared_ptr<const Source> &source() const { return source_; }
+
+    const std::shared_ptr<Arena> &arena() const { return arena_; }
+
+    ProgramNode *root() const { return root_; }
+
+    // 过程的 block；惰性分析的过程体在这里建立，其中的语法错误也在这里抛出。
+    // 各遍应当通过它访问过程体，而不是直接读 ProcedureDecl::block_。可以在多个线程上调用
+    BlockNode *body(ProcedureDecl *node) const;
+
+   private:
+    // 在 arena 中建立过程体；lazy 为 true 时其中嵌套的过程仍然惰性分析
+    BlockNode *parseBody(ProcedureDecl *node, const std::shared_ptr<Arena> &arena, bool lazy) const;
+
+    std::shared_ptr<const Source> source_;
+    // AST 的所有节点都在这里，与 ParsedProgram 同生命周期
+    std::shared_ptr<Arena> arena_;
+    ProgramNode *root_;
+    size_t max_depth_;
+    // 保护惰性建立的过程体以及建立它们时使用的 arena_
+    mutable std::mutex bodies_mutex_;
+    // 并行建立过程体时各线程的 Arena
+    std::vector<std::shared_ptr<Arena>> body_arenas_;
+};
+
+#endif
@@ -0,0 +1,178 @@
+#include "s2s_compiler.hpp"
+
+#include <stdexcept>
+
+#include "identifier.hpp"
+#include "token.hpp"
+
+namespace {
+
+// 与 Parser 中的绑定力一致：加减 < 乘除 < 一元运算符 < 字面量、变量
+constexpr uint8_t ADDITIVE_POWER = 10;
+constexpr uint8_t MULTIPLICATIVE_POWER = 20;
+constexpr uint8_t PREFIX_POWER = 30;
+constexpr uint8_t ATOM_POWER = 40;
+
+constexpr int INDENT_WIDTH = 3;
+
+}  // namespace
+
+std::string SourceToSourceCompiler::compile() {
+    output_.clear();
+    indent_ = 0;
+    program_->root()->visit(this);
+    return std::move(output_);
+}
+
+void SourceToSourceCompiler::visit(ProgramNode *node) {
+    auto name = std::string(identifiers().name(node->name_));
+    line("program " + name + "0;");
+    node->block_->visit(this);
+    output_.pop_back();
+    output_ += ". {END OF " + name + "}\n";
+}
+
+// 声明多缩进一层，复合语句与所属的 program、procedure 对齐；末尾的 "end" 之后由调用者补上 "." 或者 ";"
+void SourceToSourceCompiler::visit(BlockNode *node) {
+    ++indent_;
+    for (auto &&declaration : node->declarations_) {
+        declaration->visit(this);
+    }
+    --indent_;
+    node->compound_statement_->visit(this);
+}
+
+void SourceToSourceCompiler::visit(VarDeclNode *node) {
+    line("var " + scopedName(node->var_node_->id_, node->var_node_->binding_) + " : " + std::string(identifiers().name(node->type_node_->id_)) + ";");
+}
+
+void SourceToSourceCompiler::visit(TypeNode *node) {}
+
+void SourceToSourceCompiler::visit(ProcedureDecl *node) {
+    auto header = "procedure " + scopedName(node->proc_name_, node->binding_);
+    if (!node->params_.empty()) {
+        header += "(";
+        for (size_t i = 0; i < node->params_.size(); ++i) {
+            auto param = node->params_[i];
+            header += (i == 0 ? "" : "; ") + scopedName(param->var_node_->id_, param->var_node_->binding_) + " : " +
+                      std::string(identifiers().name(param->type_node_->id_));
+        }
+        header += ")";
+    }
+    line(header + ";");
+    program_->body(node)->visit(this);
+    output_.pop_back();
+    output_ += "; {END OF " + std::string(identifiers().name(node->proc_name_)) + "}\n";
+}
+
+void SourceToSourceCompiler::visit(ParamNode *node) {}
+
+void SourceToSourceCompiler::visit(CompoundNode *node) {
+    line("begin");
+    ++indent_;
+    for (const auto &child : node->children_) {
+        // 空语句不输出，其余语句之后加分号
+        auto size = output_.size();
+        child->visit(this);
+        if (output_.size() != size) {
+            output_.pop_back();
+            output_ += ";\n";
+        }
+    }
+    --indent_;
+    line("end");
+}
+
+// 名字解析到过程等不是变量的符号时没有槽位（depth_ 为 0），与执行引擎一样报告错误
+void SourceToSourceCompiler::visit(AssignNode *node) {
+    if (node->binding_.depth_ == 0) {
+        throw std::runtime_error("identifier " + std::string(identifiers().name(node->left_)) + " not declare");
+    }
+    line(typedName(node->left_, node->binding_, node->type_) + " := " + expression(node->right_));
+}
+
+void SourceToSourceCompiler::visit(ProcedureCallNode *node) {
+    // 与过程声明一样使用带层次的名字
+    auto call = scopedName(node->proc_name_, node->binding_) + "(";
+    for (size_t i = 0; i < node->actual_params_.size(); ++i) {
+        call += (i == 0 ? "" : ", ") + expression(node->actual_params_[i]);
+    }
+    line(call + ")");
+}
+
+void SourceToSourceCompiler::visit(NoOpNode *node) {}
+
+// 表达式节点由 expression 按中序访问：运算符节点把括号、操作数和运算符按逆序压入 pending_，叶子直接输出
+void SourceToSourceCompiler::visit(BinaryOpNode *node) {
+    auto power = node->op_.type_ == PLUS || node->op_.type_ == MINUS ? ADDITIVE_POWER : MULTIPLICATIVE_POWER;
+    auto parenthesize = power < min_power_;
+    if (parenthesize) {
+        pushText(")");
+    }
+    pushNode(node->right_, power + 1);
+    pushText(" ");
+    pushText(text(node->op_));
+    pushText(" ");
+    pushNode(node->left_, power);
+    if (parenthesize) {
+        pushText("(");
+    }
+}
+
+void SourceToSourceCompiler::visit(UnaryOpNode *node) {
+    auto parenthesize = PREFIX_POWER < min_power_;
+    if (parenthesize) {
+        pushText(")");
+    }
+    pushNode(node->expr_, PREFIX_POWER);
+    pushText(text(node->token_));
+    if (parenthesize) {
+        pushText("(");
+    }
+}
+
+void SourceToSourceCompiler::visit(NumNode *node) {
+    expression_ += text(node->token_);
+}
+
+void SourceToSourceCompiler::visit(VarNode *node) {
+    if (node->binding_.depth_ == 0) {
+        throw std::runtime_error("variable " + std::string(identifiers().name(node->id_)) + " is not defined");
+    }
+    expression_ += typedName(node->id_, node->binding_, node->type_);
+}
+
+std::string SourceToSourceCompiler::expression(ASTNode *node) {
+    expression_.clear();
+    pending_.clear();
+    pushNode(node, 0);
+    while (!pending_.empty()) {
+        auto pending = pending_.back();
+        pending_.pop_back();
+        if (pending.node_ == nullptr) {
+            expression_ += pending.text_;
+        } else {
+            min_power_ = pending.min_power_;
+            pending.node_->visit(this);
+        }
+    }
+    return std::move(expression_);
+}
+
+std::string SourceToSourceCompiler::scopedName(Identifier name, const Binding &binding) {
+    return std::string(identifiers().name(name)) + std::to_string(binding.depth_);
+}
+
+std::string SourceToSourceCompiler::typedName(Identifier name, const Binding &binding, ValueType type) {
+    return "<" + scopedName(name, binding) + ":" + typeName(type) + ">";
+}
+
+std::string_view SourceToSourceCompiler::text(const Token &token) const {
+    return program_->source()->text().substr(token.offset_, token.length_);
+}
+
+void SourceToSourceCompiler::line(const std::string &text) {
+    output_.append(static_cast<size_t>(indent_ * INDENT_WIDTH), ' ');
+    output_ += text;
+    output_ += "\n";
+}
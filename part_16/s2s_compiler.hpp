@@ -0,0 +1,90 @@
+#ifndef S2S_COMPILER_HPP_
+#define S2S_COMPILER_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.hpp"
+#include "identifier.hpp"
+#include "program.hpp"
+
+// 源到源编译：把程序翻译为每个名字都带上作用域层次的 Pascal 源码，例如
+//   program MAIN0;
+//      var X1 : INTEGER;
+//   begin
+//      <X1:INTEGER> := <X1:INTEGER> + 1;
+//   end. {END OF MAIN}
+// 名字所在的层次取自语义分析写在节点上的 binding_，类型取自 type_，程序必须先通过语义分析
+class SourceToSourceCompiler : public Visitor {
+   public:
+    explicit SourceToSourceCompiler(std::shared_ptr<const ParsedProgram> program) : program_(std::move(program)) {}
+
+    std::string compile();
+
+    void visit(ProgramNode *node) override;
+
+    void visit(BlockNode *node) override;
+
+    void visit(VarDeclNode *node) override;
+
+    void visit(TypeNode *node) override;
+
+    void visit(BinaryOpNode *node) override;
+
+    void visit(NumNode *node) override;
+
+    void visit(UnaryOpNode *node) override;
+
+    void visit(CompoundNode *node) override;
+
+    void visit(AssignNode *node) override;
+
+    void visit(VarNode *node) override;
+
+    void visit(ProcedureDecl *node) override;
+
+    void visit(ProcedureCallNode *node) override;
+
+    void visit(NoOpNode *node) override;
+
+    void visit(ParamNode *node) override;
+
+   private:
+    // 待输出的表达式节点，以及它作为操作数所需的最低绑定力（低于它时加括号）；node_ 为 nullptr 时直接输出 text_
+    struct Pending {
+        ASTNode *node_;
+        uint8_t min_power_;
+        std::string_view text_;
+    };
+
+    // 用显式栈按中序翻译表达式，不递归。各部分依次追加到同一个字符串，耗时与表达式的长度成正比
+    std::string expression(ASTNode *node);
+
+    // 在栈上按逆序压入 Pending，先压入的后输出
+    void pushNode(ASTNode *node, uint8_t min_power) { pending_.push_back({node, min_power, {}}); }
+    void pushText(std::string_view text) { pending_.push_back({nullptr, 0, text}); }
+
+    // 带层次的名字，例如 X1
+    static std::string scopedName(Identifier name, const Binding &binding);
+
+    // 带层次和类型的变量，例如 <X1:INTEGER>
+    static std::string typedName(Identifier name, const Binding &binding, ValueType type);
+
+    std::string_view text(const Token &token) const;
+
+    // 按当前缩进输出一行
+    void line(const std::string &text);
+
+    std::shared_ptr<const ParsedProgram> program_;
+    std::vector<Pending> pending_;
+    // 正在访问的表达式节点所需的最低绑定力，以及正在翻译的表达式
+    uint8_t min_power_ = 0;
+    std::string expression_;
+    std::string output_;
+    int indent_ = 0;
+};
+
+#endif
@@ -0,0 +1,16 @@
+PROGRAM Part10;
+VAR
+    number     : INTEGER;
+    a, b, c, x : INTEGER;
+    y          : REAL;
+
+BEGIN {Part10}
+    BEGIN
+        number := 2;
+        a := number;
+        b := 10 * a + 10 * number DIV 4;
+        c := a - - b
+    END;
+    x := 11;
+    y := 20 / 7 + 3.14;
+END.  {Part10}
@@ -0,0 +1,16 @@
+program Main;
+var
+   x, y : integer;
+
+procedure Alpha(a : integer; b : integer);
+var
+   z : integer;
+begin
+   z := a + b;
+end;
+
+begin { Main }
+   x := 7;
+   y := x * 3 DIV 2;
+   Alpha(x + 1, y);
+end.  { Main }
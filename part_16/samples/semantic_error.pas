@@ -0,0 +1,7 @@
+program Main;
+var
+   a : integer;
+
+begin { Main }
+   a := b;  { semantic error }
+end.  { Main }
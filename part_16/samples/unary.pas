@@ -0,0 +1,11 @@
+program Unary;
+var
+   a, b, c, d : integer;
+
+begin { Unary }
+   a := - 3;
+   b := + 3;
+   c := 5 - - - + - 3;
+   d := 5 - - - + - (3 + 4) - +2;
+   a := a * (b + c) - d DIV 2 + a
+end.  { Unary }
@@ -0,0 +1,71 @@
+#include "semantic_analyzer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
+void SemanticAnalyzer::checkParallel(unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads_ = threads;
+    check();
+}
+
+void SemanticAnalyzer::checkGlobalBlock(BlockNode *node) {
+    // 先定义所有声明。声明出错时，之前的过程体仍然要检查：其中的错误在源码中更靠前
+    std::vector<DeclaredProcedure> procedures;
+    std::exception_ptr declaration_error;
+    try {
+        for (auto declaration : node->declarations_) {
+            if (auto procedure = dynamic_cast<ProcedureDecl *>(declaration)) {
+                procedures.push_back(declareProcedure(procedure));
+            } else {
+                declaration->visit(this);
+            }
+        }
+    } catch (...) {
+        declaration_error = std::current_exception();
+    }
+    node->frame_size_ = slots_.back().variables_;
+
+    auto threads = static_cast<unsigned>(std::min<size_t>(threads_, procedures.size()));
+    std::vector<std::unique_ptr<SemanticAnalyzer>> analyzers;
+    for (unsigned i = 0; i < threads; ++i) {
+        analyzers.emplace_back(new SemanticAnalyzer(this));
+    }
+    // 各线程从 next 依次领取过程，过程体大小不一时也能保持均衡
+    std::atomic<size_t> next{0};
+    std::vector<std::exception_ptr> errors(procedures.size());
+    auto work = [&](SemanticAnalyzer *analyzer) {
+        for (auto i = next.fetch_add(1); i < procedures.size(); i = next.fetch_add(1)) {
+            try {
+                analyzer->checkProcedure(procedures[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(work, analyzers[i].get());
+    }
+    if (threads > 0) {
+        work(analyzers[0].get());
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // 过程体按声明的顺序排列，也就是源码中的顺序，并且都在出错的声明之前
+    for (const auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    if (declaration_error) {
+        std::rethrow_exception(declaration_error);
+    }
+    node->compound_statement_->visit(this);
+}
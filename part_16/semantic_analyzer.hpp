@@ -3,131 +3,241 @@
 
 #include <iostream>
 #include <memory>
-#include <sstream>
+#include <unordered_map>
 
 #include "ast.hpp"
 #include "error.hpp"
-#include "parser.hpp"
+#include "expression_walker.hpp"
+#include "program.hpp"
 #include "symbol.hpp"
-
-class SemanticAnalyzer : public std::enable_shared_from_this<SemanticAnalyzer>, public Visitor {
+#include "trace.hpp"
+
+// 检查 ParsedProgram。
+// 变量和参数的声明、变量引用、赋值目标、过程声明和过程调用解析到的 (层次, 槽位) 写在节点的 binding_ 上，
+// 各作用域帧的大小写在 BlockNode 上，执行引擎据此按下标访问变量，之后的各遍也据此得到名字所在的作用域。
+// 每个表达式节点的静态类型写在 type_ 上，按 Pascal 的规则推导：DIV 的操作数必须为 INTEGER，"/" 的结果总是 REAL，
+// 其余运算两个操作数都是 INTEGER 时为 INTEGER，否则为 REAL；REAL 的值不能赋给 INTEGER 变量
+class SemanticAnalyzer : public Visitor {
    public:
-    SemanticAnalyzer(const Parser &parser) : parser_(parser) {}
+    explicit SemanticAnalyzer(std::shared_ptr<const ParsedProgram> program) : program_(std::move(program)) {}
 
     void error(ErrorCode error_code, const Token &token) {
-        std::string message = toString(error_code);
-        message += "->";
-        std::stringstream ss;
-        ss << token;
-        message += ss.str();
-
-        throw SemanticError(error_code, token, message);
+        throw SemanticError(error_code, token, *program_->source(), "");
     }
 
-    void check() {
-        auto root_node = parser_.parse();
-        root_node->visit(shared_from_this());
-    }
+    void check() { program_->root()->visit(this); }
+
+    // 并行的检查：先在调用线程上定义全局作用域中的所有声明，之后由 threads 个线程（0 表示硬件线程数）
+    // 同时检查最外层各过程的过程体（连同其中嵌套的过程），最后在调用线程上检查主程序的语句。
+    // 各线程只读共享外层作用域，符号只在自己的作用域中定义，结论写在各自检查的节点上。
+    // 结果与 check() 相同；有多处错误时抛出源码中最靠前的一个
+    void checkParallel(unsigned threads = 0);
 
-    void visit(const std::shared_ptr<ProgramNode> &node) override {
-        std::cout << "ENTER scope: global" << std::endl;
+    void visit(ProgramNode *node) override {
+        TRACE(TRACE_SEMANTIC, TRACE_INFO, "ENTER scope: global");
         auto global_scope = std::make_shared<ScopedSymbolTable>("global", 1, current_scope_);
         current_scope_ = global_scope;
-        node->block_->visit(shared_from_this());
-        std::cout << *global_scope << std::endl;
+        slots_.emplace_back();
+        node->block_->visit(this);
+        slots_.pop_back();
+        TRACE(TRACE_SEMANTIC, TRACE_DEBUG, *global_scope);
         current_scope_ = current_scope_->enclosing_scope();
-        std::cout << "LEAVE scope: global" << std::endl;
+        TRACE(TRACE_SEMANTIC, TRACE_INFO, "LEAVE scope: global");
     }
 
-    void visit(const std::shared_ptr<BlockNode> &node) override {
+    void visit(BlockNode *node) override {
+        if (threads_ > 1 && slots_.size() == 1) {
+            checkGlobalBlock(node);
+            return;
+        }
         for (auto &&declaration : node->declarations_) {
-            declaration->visit(shared_from_this());
+            declaration->visit(this);
         }
-        node->compound_statement_->visit(shared_from_this());
+        node->frame_size_ = slots_.back().variables_;
+        node->compound_statement_->visit(this);
     }
 
-    void visit(const std::shared_ptr<VarDeclNode> &node) override {
-        auto type_name = node->type_node_->token_.str_;
-        auto type_symbol = current_scope_->lookup(type_name);
-        auto var_name = node->var_node_->value_;
+    void visit(VarDeclNode *node) override {
+        auto type_symbol = current_scope_->lookup(node->type_node_->id_);
+        auto var_name = node->var_node_->id_;
         auto var_symbol = std::make_shared<VarSymbol>(var_name, type_symbol);
         if (current_scope_->lookup(var_name, true)) {
             error(DUPLICATE_ID, node->var_node_->token_);
         }
-        current_scope_->define(var_symbol);
+        node->var_node_->binding_ = define(var_symbol, slots_.back().variables_);
+        node->var_node_->type_ = type_symbol->value_type_;
     }
 
-    void visit(const std::shared_ptr<TypeNode> &node) override {}
-
-    void visit(const std::shared_ptr<BinaryOpNode> &node) override {
-        node->left_->visit(shared_from_this());
-        node->right_->visit(shared_from_this());
+    void visit(TypeNode *node) override {}
+
+    // 表达式由 walker_ 按后序遍历，操作数已经检查过、推导出了类型
+    void visit(BinaryOpNode *node) override {
+        auto left = typeOf(node->left_);
+        auto right = typeOf(node->right_);
+        if (left == TYPE_UNKNOWN || right == TYPE_UNKNOWN) {
+            // 操作数不是变量，执行时报告
+            node->type_ = TYPE_UNKNOWN;
+        } else if (node->op_.type_ == INTEGER_DIV) {
+            if (left != TYPE_INTEGER || right != TYPE_INTEGER) {
+                error(TYPE_MISMATCH, node->op_);
+            }
+            node->type_ = TYPE_INTEGER;
+        } else if (node->op_.type_ == FLOAT_DIV) {
+            node->type_ = TYPE_REAL;
+        } else {
+            node->type_ = left == TYPE_INTEGER && right == TYPE_INTEGER ? TYPE_INTEGER : TYPE_REAL;
+        }
     }
 
-    void visit(const std::shared_ptr<NumNode> &node) override {}
+    void visit(NumNode *node) override { node->type_ = node->isReal() ? TYPE_REAL : TYPE_INTEGER; }
 
-    void visit(const std::shared_ptr<UnaryOpNode> &node) override {}
+    void visit(UnaryOpNode *node) override { node->type_ = typeOf(node->expr_); }
 
-    void visit(const std::shared_ptr<CompoundNode> &node) override {
+    void visit(CompoundNode *node) override {
         for (const auto &child : node->children_) {
-            child->visit(shared_from_this());
+            child->visit(this);
         }
     }
 
-    void visit(const std::shared_ptr<AssignNode> &node) override {
-        auto var_name = node->left_;
-        if (current_scope_->lookup(var_name) == nullptr) {
+    void visit(AssignNode *node) override {
+        auto var_symbol = current_scope_->lookup(node->left_);
+        if (var_symbol == nullptr) {
             error(ID_NOT_FOUND, node->token_);
         }
+        node->type_ = valueTypeOf(*var_symbol);
+        node->binding_ = resolveVariable(*var_symbol);
         // 无需求值，只需遍历检查
-        node->right_->visit(shared_from_this());
+        walker_.walk(node->right_, this);
+        if (node->type_ == TYPE_INTEGER && typeOf(node->right_) == TYPE_REAL) {
+            error(TYPE_MISMATCH, node->token_);
+        }
     }
 
-    void visit(const std::shared_ptr<VarNode> &node) override {
-        auto var_name = node->value_;
-        auto var_symbol = current_scope_->lookup(var_name);
+    void visit(VarNode *node) override {
+        auto var_symbol = current_scope_->lookup(node->id_);
         if (!var_symbol) {
             error(ID_NOT_FOUND, node->token_);
         }
+        node->type_ = valueTypeOf(*var_symbol);
+        node->binding_ = resolveVariable(*var_symbol);
     }
 
-    void visit(const std::shared_ptr<ProcedureDecl> &node) override {
-        auto proc_name = node->proc_name_;
-        auto proc_symbol = std::make_shared<ProcedureSymbol>(proc_name);
-        current_scope_->define(proc_symbol);
-        std::cout << "ENTER scope: " << proc_name << std::endl;
-        auto procedure_scope =
-            std::make_shared<ScopedSymbolTable>(proc_name, current_scope_->scope_level() + 1, current_scope_);
+    void visit(ProcedureDecl *node) override { checkProcedure(declareProcedure(node)); }
+
+    void visit(ProcedureCallNode *node) override {
+        auto proc_symbol = current_scope_->lookup(node->proc_name_);
+        if (proc_symbol == nullptr) {
+            error(ID_NOT_FOUND, node->token_);
+        }
+        node->binding_ = bindingOf(proc_symbol.get());
+        for (const auto &param_node : node->actual_params_) {
+            walker_.walk(param_node, this);
+        }
+    }
+
+    void visit(NoOpNode *node) override {}
+
+    void visit(ParamNode *node) override {}
+
+    void print() { std::cout << current_scope_ << std::endl; }
+
+   private:
+    // 正在分析的各层作用域中已经分配的变量槽位、过程序号
+    struct ScopeSlots {
+        uint32_t variables_ = 0;
+        uint32_t procedures_ = 0;
+    };
+
+    // 已经定义了过程名和参数、尚未检查过程体的过程
+    struct DeclaredProcedure {
+        ProcedureDecl *node_;
+        std::shared_ptr<ScopedSymbolTable> scope_;
+        ScopeSlots slots_;
+    };
+
+    // 在 parent 所在的作用域中检查过程体，符号的槽位先在自己的 bindings_ 中查找，再到 parent 中查找
+    explicit SemanticAnalyzer(const SemanticAnalyzer *parent)
+        : program_(parent->program_), current_scope_(parent->current_scope_), parent_(parent) {}
+
+    // 在当前作用域中定义过程名，建立过程的作用域并定义参数
+    DeclaredProcedure declareProcedure(ProcedureDecl *node) {
+        auto proc_symbol = std::make_shared<ProcedureSymbol>(node->proc_name_);
+        node->binding_ = define(proc_symbol, slots_.back().procedures_);
+        TRACE(TRACE_SEMANTIC, TRACE_INFO, "ENTER scope: " << proc_symbol->name_);
+        auto procedure_scope = std::make_shared<ScopedSymbolTable>(std::string(proc_symbol->name_),
+                                                                   current_scope_->scope_level() + 1, current_scope_);
         current_scope_ = procedure_scope;
+        // 参数依次占据帧的前几个槽位
+        slots_.emplace_back();
 
         for (const auto &param : node->params_) {
-            auto param_type = current_scope_->lookup(param->type_node_->value());
-            auto param_name = param->var_node_->value_;
-            auto var_symbol = std::make_shared<VarSymbol>(param_name, param_type);
-            current_scope_->define(var_symbol);
+            auto param_type = current_scope_->lookup(param->type_node_->id_);
+            auto var_symbol = std::make_shared<VarSymbol>(param->var_node_->id_, param_type);
+            param->var_node_->binding_ = define(var_symbol, slots_.back().variables_);
+            param->var_node_->type_ = param_type->value_type_;
             proc_symbol->params.push_back(std::move(var_symbol));
         }
-        node->block_->visit(shared_from_this());
-        std::cout << *procedure_scope << std::endl;
+        DeclaredProcedure procedure = {node, procedure_scope, slots_.back()};
+        slots_.pop_back();
         current_scope_ = current_scope_->enclosing_scope();
-        std::cout << "LEAVE scope: " << proc_name << std::endl;
+        return procedure;
     }
 
-    void visit(const std::shared_ptr<ProcedureCallNode> &node) override {
-        for (const auto &param_node : node->actual_params_) {
-            param_node->visit(shared_from_this());
-        }
+    // 在过程的作用域中检查过程体
+    void checkProcedure(const DeclaredProcedure &procedure) {
+        current_scope_ = procedure.scope_;
+        slots_.push_back(procedure.slots_);
+        program_->body(procedure.node_)->visit(this);
+        slots_.pop_back();
+        TRACE(TRACE_SEMANTIC, TRACE_DEBUG, *procedure.scope_);
+        current_scope_ = current_scope_->enclosing_scope();
+        TRACE(TRACE_SEMANTIC, TRACE_INFO, "LEAVE scope: " << identifiers().name(procedure.node_->proc_name_));
+    }
+
+    // checkParallel() 中的全局作用域
+    void checkGlobalBlock(BlockNode *node);
+
+    // 变量（包括参数）的类型；过程等其他符号为 TYPE_UNKNOWN
+    static ValueType valueTypeOf(const Symbol &symbol) {
+        return symbol.type_ != nullptr ? symbol.type_->value_type_ : TYPE_UNKNOWN;
     }
 
-    void visit(const std::shared_ptr<NoOpNode> &node) override {}
+    // 在当前作用域中定义符号，占据 counter 所计数的下一个槽位
+    Binding define(std::shared_ptr<Symbol> symbol, uint32_t &counter) {
+        auto level = current_scope_->scope_level();
+        Binding binding;
+        binding.depth_ = static_cast<uint32_t>(level);
+        binding.slot_ = counter++;
+        bindings_[symbol.get()] = binding;
+        current_scope_->define(std::move(symbol));
+        return binding;
+    }
 
-    void visit(const std::shared_ptr<ParamNode> &node) override {}
+    // 没有槽位的符号（例如类型）为 Binding()
+    Binding bindingOf(const Symbol *symbol) const {
+        auto it = bindings_.find(symbol);
+        if (it != bindings_.end()) {
+            return it->second;
+        }
+        return parent_ != nullptr ? parent_->bindingOf(symbol) : Binding();
+    }
 
-    void print() { std::cout << current_scope_ << std::endl; }
+    // 作为变量使用的名字。解析到过程等其他符号时不分配槽位（depth_ 为 0），由执行引擎报告变量未定义
+    Binding resolveVariable(const Symbol &symbol) const {
+        // 只有变量（包括参数）的符号带有类型
+        return symbol.type_ != nullptr ? bindingOf(&symbol) : Binding();
+    }
 
-   private:
+    std::shared_ptr<const ParsedProgram> program_;
     std::shared_ptr<ScopedSymbolTable> current_scope_ = nullptr;
-    Parser parser_;
+    ExpressionWalker<SemanticAnalyzer> walker_;
+    // 每个已定义的符号所在作用域的层次以及槽位
+    std::unordered_map<const Symbol *, Binding> bindings_;
+    std::vector<ScopeSlots> slots_;
+    // checkParallel() 使用的线程数；检查过程体的线程为 1
+    unsigned threads_ = 1;
+    // 检查过程体的线程所属的分析器，只读
+    const SemanticAnalyzer *parent_ = nullptr;
 };
 
 #endif
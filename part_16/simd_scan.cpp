@@ -0,0 +1,164 @@
+#include "simd_scan.hpp"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2_TARGET 1
+#endif
+
+namespace {
+
+inline bool isSpace(char c) {
+    return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+}
+
+const char *skipSpacesScalar(const char *p, const char *end) {
+    while (p < end && isSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+const char *findCommentEndScalar(const char *p, const char *end) {
+    while (p < end && *p != '}') {
+        ++p;
+    }
+    return p;
+}
+
+#if defined(__SSE2__)
+
+// 每次比较 16 字节：空白字符为 ' ' 以及 '\t'..'\r'（无符号比较 c - '\t' <= 4）
+const char *skipSpacesSSE2(const char *p, const char *end) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i range = _mm_set1_epi8('\r' - '\t');
+    while (end - p >= 16) {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i offset = _mm_sub_epi8(chars, tab);
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(offset, range), offset);
+        __m128i spaces = _mm_or_si128(control, _mm_cmpeq_epi8(chars, space));
+        auto space_mask = static_cast<unsigned>(_mm_movemask_epi8(spaces));
+        if (space_mask != 0xffff) {
+            return p + __builtin_ctz(~space_mask);
+        }
+        p += 16;
+    }
+    return skipSpacesScalar(p, end);
+}
+
+const char *findCommentEndSSE2(const char *p, const char *end) {
+    const __m128i brace = _mm_set1_epi8('}');
+    while (end - p >= 16) {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        auto brace_mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chars, brace)));
+        if (brace_mask != 0) {
+            return p + __builtin_ctz(brace_mask);
+        }
+        p += 16;
+    }
+    return findCommentEndScalar(p, end);
+}
+
+#endif
+
+#if defined(HAVE_AVX2_TARGET)
+
+// 与 SSE2 版本相同，每次比较 32 字节；仅在运行时检测到 AVX2 时使用
+__attribute__((target("avx2"))) const char *skipSpacesAVX2(const char *p, const char *end) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i range = _mm256_set1_epi8('\r' - '\t');
+    while (end - p >= 32) {
+        __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i offset = _mm256_sub_epi8(chars, tab);
+        __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, range), offset);
+        __m256i spaces = _mm256_or_si256(control, _mm256_cmpeq_epi8(chars, space));
+        auto space_mask = static_cast<unsigned>(_mm256_movemask_epi8(spaces));
+        if (space_mask != ~0u) {
+            return p + __builtin_ctz(~space_mask);
+        }
+        p += 32;
+    }
+    return skipSpacesScalar(p, end);
+}
+
+__attribute__((target("avx2"))) const char *findCommentEndAVX2(const char *p, const char *end) {
+    const __m256i brace = _mm256_set1_epi8('}');
+    while (end - p >= 32) {
+        __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        auto brace_mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, brace)));
+        if (brace_mask != 0) {
+            return p + __builtin_ctz(brace_mask);
+        }
+        p += 32;
+    }
+    return findCommentEndScalar(p, end);
+}
+
+#endif
+
+struct ScanFunctions {
+    const char *(*skip_spaces_)(const char *, const char *);
+    const char *(*find_comment_end_)(const char *, const char *);
+    const char *name_;
+};
+
+const ScanFunctions scalar_functions = {skipSpacesScalar, findCommentEndScalar, "scalar"};
+
+ScanFunctions bestFunctions() {
+#if defined(HAVE_AVX2_TARGET)
+    if (__builtin_cpu_supports("avx2")) {
+        return {skipSpacesAVX2, findCommentEndAVX2, "avx2"};
+    }
+#endif
+#if defined(__SSE2__)
+    return {skipSpacesSSE2, findCommentEndSSE2, "sse2"};
+#else
+    return scalar_functions;
+#endif
+}
+
+ScanFunctions active_functions = bestFunctions();
+
+}  // namespace
+
+const char *skipSpaces(const char *begin, const char *end) {
+    // 大多数空白只有一两个字符，先用标量判断，避免为此加载整个向量
+    if (end - begin >= 2 && !isSpace(begin[1])) {
+        return skipSpacesScalar(begin, begin + 2);
+    }
+    return active_functions.skip_spaces_(begin, end);
+}
+
+const char *findCommentEnd(const char *begin, const char *end) {
+    return active_functions.find_comment_end_(begin, end);
+}
+
+const char *scanImplementation() {
+    return active_functions.name_;
+}
+
+bool selectScanImplementation(const char *name) {
+    if (std::strcmp(name, "scalar") == 0) {
+        active_functions = scalar_functions;
+        return true;
+    }
+    auto best = bestFunctions();
+    if (std::strcmp(name, best.name_) == 0 || std::strcmp(name, "best") == 0) {
+        active_functions = best;
+        return true;
+    }
+#if defined(__SSE2__)
+    if (std::strcmp(name, "sse2") == 0) {
+        active_functions = {skipSpacesSSE2, findCommentEndSSE2, "sse2"};
+        return true;
+    }
+#endif
+    return false;
+}
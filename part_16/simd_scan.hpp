@@ -0,0 +1,18 @@
+#ifndef SIMD_SCAN_HPP_
+#define SIMD_SCAN_HPP_
+
+#include <cstddef>
+
+// 返回 [begin, end) 中第一个非空白字符（isspace 意义下）的位置，找不到时返回 end
+const char *skipSpaces(const char *begin, const char *end);
+
+// 返回 [begin, end) 中第一个 '}' 的位置，找不到时返回 end
+const char *findCommentEnd(const char *begin, const char *end);
+
+// 当前使用的实现："avx2"、"sse2" 或 "scalar"
+const char *scanImplementation();
+
+// 切换实现（"scalar"、"sse2"、"avx2" 或 "best"），主要用于基准测试；不支持时返回 false
+bool selectScanImplementation(const char *name);
+
+#endif
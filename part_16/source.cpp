@@ -0,0 +1,137 @@
+#include "source.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_MMAP 1
+#else
+#include <cstdio>
+#endif
+
+Source::Source(void *mapping, size_t size)
+    : mapping_(mapping), mapping_size_(size), view_(static_cast<const char *>(mapping), size) {}
+
+Source::~Source() {
+#ifdef HAVE_MMAP
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_size_);
+    }
+#endif
+}
+
+static std::runtime_error ioError(const std::string &what, const std::string &path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+#ifdef HAVE_MMAP
+
+static std::string readAll(int fd, const std::string &path) {
+    std::string text;
+    size_t size = 0;
+    text.resize(64 * 1024);
+    for (;;) {
+        if (size == text.size()) {
+            text.resize(text.size() * 2);
+        }
+        auto n = read(fd, &text[size], text.size() - size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw ioError("cannot read", path);
+        }
+        if (n == 0) {
+            break;
+        }
+        size += static_cast<size_t>(n);
+    }
+    text.resize(size);
+    return text;
+}
+
+std::shared_ptr<const Source> Source::fromFile(const std::string &path) {
+    if (path == "-") {
+        return std::make_shared<const Source>(readAll(STDIN_FILENO, "<stdin>"));
+    }
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw ioError("cannot open", path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw ioError("cannot stat", path);
+    }
+    if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+        std::string text;
+        try {
+            text = readAll(fd, path);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        close(fd);
+        return std::make_shared<const Source>(std::move(text));
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw ioError("cannot mmap", path);
+    }
+    // 词法分析从头到尾顺序扫描
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    return std::shared_ptr<const Source>(new Source(mapping, size));
+}
+
+#else
+
+std::shared_ptr<const Source> Source::fromFile(const std::string &path) {
+    FILE *file = path == "-" ? stdin : std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        throw ioError("cannot open", path);
+    }
+    std::string text;
+    char buffer[64 * 1024];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, n);
+    }
+    if (file != stdin) {
+        std::fclose(file);
+    }
+    return std::make_shared<const Source>(std::move(text));
+}
+
+#endif
+
+SourcePosition Source::position(size_t offset) const {
+    std::call_once(line_starts_once_, [this] {
+        line_starts_.push_back(0);
+        // memchr 由 libc 向量化实现
+        auto *begin = view_.data();
+        auto *end = begin + view_.size();
+        for (auto *p = begin; p < end;) {
+            auto *newline = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (newline == nullptr) {
+                break;
+            }
+            p = newline + 1;
+            line_starts_.push_back(static_cast<size_t>(p - begin));
+        }
+    });
+    if (offset > view_.size()) {
+        offset = view_.size();
+    }
+    auto line = std::upper_bound(line_starts_.begin(), line_starts_.end(), offset) - line_starts_.begin();
+    auto column = offset - line_starts_[line - 1] + 1;
+    return {static_cast<uint32_t>(line), static_cast<uint32_t>(column)};
+}
@@ -0,0 +1,52 @@
+#ifndef SOURCE_HPP_
+#define SOURCE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 行号、列号均从 1 开始
+struct SourcePosition {
+    uint32_t lineno_;
+    uint32_t column_;
+};
+
+// 一次编译的源码，只保存一份。Lexer、Parser 通过 shared_ptr 共享它，
+// Token 记录的是在这里的偏移。
+// 源码可以来自内存中的字符串，也可以是只读映射（mmap）的文件。
+class Source {
+   public:
+    explicit Source(std::string text) : text_(std::move(text)), view_(text_) {}
+    ~Source();
+
+    Source(const Source &) = delete;
+    Source &operator=(const Source &) = delete;
+
+    // 普通文件使用 mmap 只读映射；管道、终端等无法映射的输入（包括 "-" 表示的标准输入）退化为分块读取
+    static std::shared_ptr<const Source> fromFile(const std::string &path);
+
+    std::string_view text() const { return view_; }
+
+    bool mapped() const { return mapping_ != nullptr; }
+
+    // 把字节偏移换算为行号、列号：第一次调用时建立行首偏移表，之后二分查找。
+    // 词法分析本身只记录偏移，只有报错、输出 token 时才需要行列号。
+    SourcePosition position(size_t offset) const;
+
+   private:
+    Source(void *mapping, size_t size);
+
+    std::string text_;
+    void *mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    std::string_view view_;
+    // 每一行行首的偏移，按需建立
+    mutable std::once_flag line_starts_once_;
+    mutable std::vector<size_t> line_starts_;
+};
+
+#endif
@@ -1,6 +1,6 @@
 #include "symbol.hpp"
 
-#include <iostream>
+#include "trace.hpp"
 
 std::ostream &operator<<(std::ostream &out, const Symbol &symbol) {
     if (symbol.type_) {
@@ -19,10 +19,11 @@ std::ostream &operator<<(std::ostream &out, const SymbolTable &table) {
     return out;
 }
 
-std::shared_ptr<Symbol> SymbolTable::lookup(const std::string &name) {
+std::shared_ptr<Symbol> SymbolTable::lookup(Identifier id) {
     std::shared_ptr<Symbol> ret = nullptr;
-    if (symbols_.find(name) != symbols_.end()) {
-        ret = symbols_[name];
+    auto it = symbols_.find(id);
+    if (it != symbols_.end()) {
+        ret = it->second;
     }
     return ret;
 }
@@ -37,19 +38,92 @@ std::ostream &operator<<(std::ostream &out, const ScopedSymbolTable &table) {
     }
     out << "Scope (Scope symbol table) contents\n";
     out << "-----------------------------------" << std::endl;
-    for (const auto &[name, symbol] : table.symbols_) {
+    for (const auto &symbol : table.symbols_) {
         out << *symbol << std::endl;
     }
     return out;
 }
 
-std::shared_ptr<Symbol> ScopedSymbolTable::lookup(const std::string &name, bool current_scope_only) {
-    std::cout << "lookup: " << name << ". (Scope name: " << scope_name_ << ")" << std::endl;
-    if (symbols_.find(name) != symbols_.end()) {
-        return symbols_[name];
+ScopedSymbolTable::ScopedSymbolTable(std::string scope_name, int scope_level,
+                                     std::shared_ptr<ScopedSymbolTable> enclosing_scope)
+    : enclosing_scope_(std::move(enclosing_scope)), scope_name_(std::move(scope_name)), scope_level_(scope_level) {
+    if (enclosing_scope_ != nullptr) {
+        chain_.reserve(enclosing_scope_->chain_.size() + 1);
+        chain_.push_back({enclosing_scope_.get(), enclosing_scope_->symbols_.size()});
+        chain_.insert(chain_.end(), enclosing_scope_->chain_.begin(), enclosing_scope_->chain_.end());
+    } else {
+        chain_.push_back({&builtins(), builtins().symbols_.size()});
     }
-    if (enclosing_scope_ != nullptr && !current_scope_only) {
-        return enclosing_scope_->lookup(name);
+    rehash(8);
+}
+
+ScopedSymbolTable::ScopedSymbolTable(std::string scope_name) : scope_name_(std::move(scope_name)), scope_level_(0) {
+    rehash(8);
+}
+
+const ScopedSymbolTable &ScopedSymbolTable::builtins() {
+    // 局部静态变量的初始化是线程安全的，之后不再修改
+    static const ScopedSymbolTable table = [] {
+        ScopedSymbolTable root("builtins");
+        root.define(std::make_shared<BuiltinTypeSymbol>(identifiers().intern("INTEGER"), TYPE_INTEGER));
+        root.define(std::make_shared<BuiltinTypeSymbol>(identifiers().intern("REAL"), TYPE_REAL));
+        return root;
+    }();
+    return table;
+}
+
+void ScopedSymbolTable::define(std::shared_ptr<Symbol> symbol) {
+    auto mask = index_.size() - 1;
+    auto i = symbol->id_ & mask;
+    for (; index_[i] != EMPTY; i = (i + 1) & mask) {
+        // 重复定义时替换原来的符号
+        if (symbols_[index_[i]]->id_ == symbol->id_) {
+            symbols_[index_[i]] = std::move(symbol);
+            return;
+        }
+    }
+    index_[i] = static_cast<uint32_t>(symbols_.size());
+    symbols_.push_back(std::move(symbol));
+    if (symbols_.size() * 2 > index_.size()) {
+        rehash(index_.size() * 2);
+    }
+}
+
+void ScopedSymbolTable::rehash(size_t capacity) {
+    index_.assign(capacity, EMPTY);
+    auto mask = capacity - 1;
+    for (uint32_t k = 0; k < symbols_.size(); ++k) {
+        auto i = symbols_[k]->id_ & mask;
+        while (index_[i] != EMPTY) {
+            i = (i + 1) & mask;
+        }
+        index_[i] = k;
+    }
+}
+
+const std::shared_ptr<Symbol> *ScopedSymbolTable::find(Identifier id, size_t limit) const {
+    auto mask = index_.size() - 1;
+    for (auto i = id & mask; index_[i] != EMPTY; i = (i + 1) & mask) {
+        if (symbols_[index_[i]]->id_ == id) {
+            return index_[i] < limit ? &symbols_[index_[i]] : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Symbol> ScopedSymbolTable::lookup(Identifier id, bool current_scope_only) {
+    TRACE(TRACE_SEMANTIC, TRACE_DEBUG, "lookup: " << identifiers().name(id) << ". (Scope name: " << scope_name_ << ")");
+    if (auto symbol = find(id)) {
+        return *symbol;
+    }
+    if (current_scope_only) {
+        return nullptr;
+    }
+    // 沿预先计算的链查找，只在开始查找的作用域输出一次跟踪
+    for (auto enclosing : chain_) {
+        if (auto symbol = enclosing.scope_->find(id, enclosing.visible_)) {
+            return *symbol;
+        }
     }
     return nullptr;
-}
\ No newline at end of file
+}
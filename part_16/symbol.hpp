@@ -1,81 +1,112 @@
 #ifndef SYMBOL_HPP_
 #define SYMBOL_HPP_
 
+#include <cstdint>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
+#include "identifier.hpp"
+#include "value.hpp"
+
 class Symbol {
    public:
-    Symbol(std::string name, std::shared_ptr<Symbol> type) : name_(std::move(name)), type_(type) {}
+    Symbol(Identifier id, std::shared_ptr<Symbol> type) : id_(id), name_(identifiers().name(id)), type_(type) {}
 
-    std::string name_;
+    Identifier id_;
+    // 驻留池中的大写名字，只用于输出
+    std::string_view name_;
     std::shared_ptr<Symbol> type_;
+    // 内建类型对应的值类型；其它符号为 TYPE_UNKNOWN，变量的类型为 type_->value_type_
+    ValueType value_type_ = TYPE_UNKNOWN;
 };
 
 std::ostream &operator<<(std::ostream &out, const Symbol &symbol);
 
 class BuiltinTypeSymbol : public Symbol {
    public:
-    BuiltinTypeSymbol(std::string name) : Symbol(std::move(name), nullptr) {}
+    BuiltinTypeSymbol(Identifier id, ValueType value_type) : Symbol(id, nullptr) { value_type_ = value_type; }
 };
 
 class VarSymbol : public Symbol {
    public:
-    VarSymbol(std::string name, std::shared_ptr<Symbol> type) : Symbol(std::move(name), type) {}
+    VarSymbol(Identifier id, std::shared_ptr<Symbol> type) : Symbol(id, type) {}
 };
 
 class ProcedureSymbol : public Symbol {
    public:
-    ProcedureSymbol(std::string name /* params */) : Symbol(std::move(name), nullptr) {}
+    ProcedureSymbol(Identifier id /* params */) : Symbol(id, nullptr) {}
     std::vector<std::shared_ptr<VarSymbol>> params;
 };
 
+// 以驻留编号作为 key
+using SymbolMap = std::unordered_map<Identifier, std::shared_ptr<Symbol>>;
+
 class SymbolTable {
    public:
     SymbolTable() { init_builtins(); }
 
-    void define(std::shared_ptr<Symbol> symbol) { symbols_[symbol->name_] = symbol; }
+    void define(std::shared_ptr<Symbol> symbol) { symbols_[symbol->id_] = std::move(symbol); }
 
-    std::shared_ptr<Symbol> lookup(const std::string &name);
+    std::shared_ptr<Symbol> lookup(Identifier id);
 
-    std::unordered_map<std::string, std::shared_ptr<Symbol>> symbols_;
+    SymbolMap symbols_;
 
    private:
     void init_builtins() {
-        define(std::make_shared<BuiltinTypeSymbol>("INTEGER"));
-        define(std::make_shared<BuiltinTypeSymbol>("REAL"));
+        define(std::make_shared<BuiltinTypeSymbol>(identifiers().intern("INTEGER"), TYPE_INTEGER));
+        define(std::make_shared<BuiltinTypeSymbol>(identifiers().intern("REAL"), TYPE_REAL));
     }
 };
 
 std::ostream &operator<<(std::ostream &out, const SymbolTable &table);
 
+// 作用域。本作用域的符号按定义顺序连续存放在 symbols_ 中，index_ 是以驻留编号为 key 的开放寻址表，
+// 槽中存放 symbols_ 的下标，桶的位置由编号直接取低位得到，不需要计算字符串的哈希。
+// 内建类型 INTEGER、REAL 只在所有作用域链末端共享的 builtins() 中定义一次，不再在每个作用域中分配。
+// 外层作用域在构造时就已确定，chain_ 预先记录了由近及远的整条链，lookup 依次查找，不再递归
 class ScopedSymbolTable {
    public:
     friend std::ostream &operator<<(std::ostream &out, const ScopedSymbolTable &table);
 
-    ScopedSymbolTable(std::string scope_name, int scope_level, std::shared_ptr<ScopedSymbolTable> enclosing_scope = nullptr)
-        : scope_name_(std::move(scope_name)), scope_level_(scope_level), enclosing_scope_(std::move(enclosing_scope)) {
-        init_builtins();
-    }
+    ScopedSymbolTable(std::string scope_name, int scope_level, std::shared_ptr<ScopedSymbolTable> enclosing_scope = nullptr);
 
-    void define(std::shared_ptr<Symbol> symbol) { symbols_[symbol->name_] = symbol; }
+    void define(std::shared_ptr<Symbol> symbol);
 
-    std::shared_ptr<Symbol> lookup(const std::string &name, bool current_scope_only = false);
+    std::shared_ptr<Symbol> lookup(Identifier id, bool current_scope_only = false);
 
     int scope_level() { return scope_level_; }
     std::shared_ptr<ScopedSymbolTable> enclosing_scope() { return enclosing_scope_; }
 
+    // 只读的内建作用域，层次为 0，所有线程共享
+    static const ScopedSymbolTable &builtins();
+
    private:
-    void init_builtins() {
-        define(std::make_shared<BuiltinTypeSymbol>("INTEGER"));
-        define(std::make_shared<BuiltinTypeSymbol>("REAL"));
-    }
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    // 只用于建立 builtins()，没有外层作用域
+    explicit ScopedSymbolTable(std::string scope_name);
+
+    // 只在本作用域的前 limit 个符号中查找，没有时返回 nullptr
+    const std::shared_ptr<Symbol> *find(Identifier id, size_t limit = SIZE_MAX) const;
+
+    void rehash(size_t capacity);
 
-    std::unordered_map<std::string, std::shared_ptr<Symbol>> symbols_;
+    std::vector<std::shared_ptr<Symbol>> symbols_;
+    // 容量为 2 的幂，空槽为 EMPTY，装载率不超过一半
+    std::vector<uint32_t> index_;
     std::shared_ptr<ScopedSymbolTable> enclosing_scope_;
+    // 外层作用域，由近及远，最后是 builtins()。外层作用域由 enclosing_scope_ 保持存活。
+    // 只能看到外层作用域在本作用域建立之前定义的符号（先声明后使用），
+    // 因此外层作用域之后再定义符号，也不影响本作用域中的查找
+    struct Enclosing {
+        const ScopedSymbolTable *scope_;
+        size_t visible_;
+    };
+    std::vector<Enclosing> chain_;
     std::string scope_name_;
     int scope_level_;
 };
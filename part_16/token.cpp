@@ -1,5 +1,7 @@
 #include "token.hpp"
 
+#include <sstream>
+
 std::ostream &operator<<(std::ostream &out, const TokenType &type) {
     switch (type) {
         case BEGIN:
@@ -50,20 +52,43 @@ std::ostream &operator<<(std::ostream &out, const TokenType &type) {
         case PROCEDURE:
             out << "PROCEDURE";
             break;
+        case PROGRAM:
+            out << "PROGRAM";
+            break;
+        case VAR:
+            out << "VAR";
+            break;
+        case COLON:
+            out << "COLON";
+            break;
+        case COMMA:
+            out << "COMMA";
+            break;
+        case REAL:
+            out << "REAL";
+            break;
+        case INTEGER_CONST:
+            out << "INTEGER_CONST";
+            break;
+        case REAL_CONST:
+            out << "REAL_CONST";
+            break;
         default:
             break;
     }
     return out;
 }
 
-std::ostream &operator<<(std::ostream &out, const Token &token) {
+std::string toString(const Token &token, const Source &source) {
+    std::stringstream out;
     out << "Token(" << token.type_ << ", ";
-    if (token.str_.empty()) {
-        out << token.value_;
+    if (token.type_ == END_OF_FILE) {
+        out << "EOF";
     } else {
-        out << token.str_;
+        out << token.text(source.text());
     }
-    out << ", position=" << token.lineno_ << ":" << token.column_;
+    auto position = source.position(token.offset_);
+    out << ", position=" << position.lineno_ << ":" << position.column_;
     out << ")";
-    return out;
+    return out.str();
 }
@@ -1,12 +1,17 @@
 #ifndef TOKEN_HPP
 #define TOKEN_HPP
 
-#include <limits>
+#include <cstdint>
 #include <ostream>
 #include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "identifier.hpp"
+#include "source.hpp"
 
 #define INVALID_CHAR 0
-enum TokenType {
+enum TokenType : uint8_t {
     BEGIN,          // "BEGIN"
     END,            // "END"
     DOT,            // "."
@@ -30,28 +35,38 @@ enum TokenType {
     INTEGER_DIV,    // 整数除法（DIV关键字）
     FLOAT_DIV,      // 浮点除法（/）
     PROCEDURE,      // "PROCEDURE"
+    TOKEN_TYPE_COUNT  // token 类型的个数，用于按类型查表
 };
 
 std::ostream &operator<<(std::ostream &out, const TokenType &type);
 
+// 紧凑的 token：只记录在源码中的位置与长度，文本以及行号、列号需要时再从源码中还原。
+// 大量 AST 节点内嵌 Token，保持 16 字节并且可以按字节复制。
 class Token {
    public:
-    TokenType type_;
-    int value_ = std::numeric_limits<int>::infinity();
-    float float_value_ = std::numeric_limits<float>::infinity();
-    std::string str_;
-    int lineno_;
-    int column_;
-
-    Token(int lineno = 0, int column = 0) : lineno_(lineno), column_(column){};
-    Token(TokenType type, float value, int lineno = 0, int column = 0)
-        : type_(type), float_value_(value), lineno_(lineno), column_(column) {}
-    Token(TokenType type, int value, int lineno = 0, int column = 0)
-        : type_(type), value_(value), lineno_(lineno), column_(column) {}
-    Token(TokenType type, std::string str, int lineno = 0, int column = 0)
-        : type_(type), str_(std::move(str)), lineno_(lineno), column_(column) {}
+    // 单个 token（标识符、数字）的最大长度
+    static constexpr size_t MAX_LENGTH = UINT16_MAX;
+
+    TokenType type_ = END_OF_FILE;
+    uint16_t length_ = 0;
+    uint32_t offset_ = 0;  // 在源码中的字节偏移
+    union {
+        int64_t value_ = 0;  // INTEGER_CONST
+        double real_value_;  // REAL_CONST
+        Identifier id_;      // ID 的驻留编号
+    };
+
+    Token() = default;
+    Token(TokenType type, size_t offset, size_t length)
+        : type_(type), length_(static_cast<uint16_t>(length)), offset_(static_cast<uint32_t>(offset)) {}
+
+    std::string_view text(std::string_view source) const { return source.substr(offset_, length_); }
 };
 
-std::ostream &operator<<(std::ostream &out, const Token &token);
+static_assert(sizeof(Token) == 16, "Token should stay compact");
+static_assert(std::is_trivially_copyable<Token>::value, "Token is copied bytewise");
+
+// 例如 "Token(ID, b, position=6:9)"
+std::string toString(const Token &token, const Source &source);
 
 #endif
@@ -0,0 +1,118 @@
+#include "token_pipeline.hpp"
+
+#include <chrono>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// 等待另一个线程：先忙等一小会儿，之后让出 CPU（单核机器上只能靠对方线程推进）
+template <typename Ready>
+bool waitUntil(Ready ready, const std::atomic<bool> &stop) {
+    for (int spins = 0; !ready(); ++spins) {
+        if (stop.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        if (spins >= 64) {
+            std::this_thread::yield();
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+TokenPipeline::TokenPipeline(std::shared_ptr<const Source> source)
+    : source_(std::move(source)), ring_(new Batch[RING_SIZE]), eof_(END_OF_FILE, source_->text().size(), 0) {
+    // Lexer 在这里构造，源码过大之类的错误直接在调用者的线程上抛出
+    thread_ = std::thread(&TokenPipeline::produce, this, Lexer(source_));
+}
+
+TokenPipeline::~TokenPipeline() {
+    stop_.store(true, std::memory_order_relaxed);
+    thread_.join();
+}
+
+void TokenPipeline::produce(Lexer lexer) {
+    size_t head = 0;
+    bool done = false;
+    while (!done) {
+        auto wait_start = Clock::now();
+        auto has_space = [&] { return head - tail_.load(std::memory_order_acquire) < RING_SIZE; };
+        if (!has_space()) {
+            if (!waitUntil(has_space, stop_)) {
+                return;
+            }
+            lexer_wait_seconds_ += secondsSince(wait_start);
+        }
+
+        auto lex_start = Clock::now();
+        auto &batch = ring_[head % RING_SIZE];
+        batch.size_ = 0;
+        batch.error_ = nullptr;
+        try {
+            while (batch.size_ < BATCH_SIZE) {
+                auto token = lexer.getNextToken();
+                batch.tokens_[batch.size_++] = token;
+                if (token.type_ == END_OF_FILE) {
+                    done = true;
+                    break;
+                }
+            }
+        } catch (...) {
+            batch.error_ = std::current_exception();
+            done = true;
+        }
+        lex_seconds_ += secondsSince(lex_start);
+        head_.store(++head, std::memory_order_release);
+    }
+}
+
+bool TokenPipeline::fetch() {
+    if (finished_) {
+        return false;
+    }
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if (batch_ != nullptr) {
+        if (batch_->error_) {
+            std::rethrow_exception(batch_->error_);
+        }
+        if (batch_->size_ > 0 && batch_->tokens_[batch_->size_ - 1].type_ == END_OF_FILE) {
+            // 一直返回 eof_，不再占用缓冲区
+            finished_ = true;
+            tail_.store(tail + 1, std::memory_order_release);
+            batch_ = nullptr;
+            index_ = 0;
+            size_ = 0;
+            return false;
+        }
+        tail_.store(++tail, std::memory_order_release);
+    }
+
+    auto has_batch = [&] { return head_.load(std::memory_order_acquire) > tail; };
+    if (!has_batch()) {
+        auto wait_start = Clock::now();
+        waitUntil(has_batch, stop_);
+        consumer_wait_seconds_ += secondsSince(wait_start);
+    }
+    batch_ = &ring_[tail % RING_SIZE];
+    index_ = 0;
+    size_ = batch_->size_;
+    if (size_ == 0) {
+        // 这一批的第一个 token 就出错了
+        std::rethrow_exception(batch_->error_);
+    }
+    return true;
+}
+
+TokenPipeline::Stats TokenPipeline::stats() const {
+    Stats stats;
+    stats.lex_seconds_ = lex_seconds_;
+    stats.lexer_wait_seconds_ = lexer_wait_seconds_;
+    stats.consumer_wait_seconds_ = consumer_wait_seconds_;
+    return stats;
+}
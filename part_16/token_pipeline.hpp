@@ -0,0 +1,86 @@
+#ifndef TOKEN_PIPELINE_HPP_
+#define TOKEN_PIPELINE_HPP_
+
+#include <array>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <thread>
+
+#include "lexer.hpp"
+#include "source.hpp"
+#include "token.hpp"
+
+// 流水线式的前端：Lexer 在自己的线程上分析，每攒满一批 token 就放入一个无锁的单生产者、
+// 单消费者环形缓冲区，Parser 在当前线程上同时从中取 token。
+// 环形缓冲区写满时 Lexer 等待 Parser，因此内存占用有上界（RING_SIZE * BATCH_SIZE 个 token），
+// 与源码大小无关。词法错误在 Parser 取到出错位置时才抛出，与顺序分析一致。
+// next() 只能在一个线程上调用。
+class TokenPipeline {
+   public:
+    static constexpr size_t BATCH_SIZE = 4096;
+    static constexpr size_t RING_SIZE = 8;
+
+    // 两个线程各自的耗时，用于估计重叠程度
+    struct Stats {
+        double lex_seconds_ = 0;            // Lexer 实际分析的时间
+        double lexer_wait_seconds_ = 0;     // Lexer 因缓冲区已满而等待的时间
+        double consumer_wait_seconds_ = 0;  // Parser 因缓冲区为空而等待的时间
+    };
+
+    explicit TokenPipeline(std::shared_ptr<const Source> source);
+    ~TokenPipeline();
+
+    TokenPipeline(const TokenPipeline &) = delete;
+    TokenPipeline &operator=(const TokenPipeline &) = delete;
+
+    const std::shared_ptr<const Source> &source() const { return source_; }
+
+    // 下一个 token；取到 END_OF_FILE 之后一直返回 END_OF_FILE
+    Token next() {
+        if (index_ == size_ && !fetch()) {
+            return eof_;
+        }
+        return batch_->tokens_[index_++];
+    }
+
+    // 取到 END_OF_FILE 或者词法错误之后才是完整的
+    Stats stats() const;
+
+   private:
+    struct Batch {
+        std::array<Token, BATCH_SIZE> tokens_;
+        size_t size_ = 0;
+        // 分析这一批中最后一个 token 之后出错
+        std::exception_ptr error_;
+    };
+
+    // Lexer 线程
+    void produce(Lexer lexer);
+
+    // 归还当前批次，等待下一批；已经取完 END_OF_FILE 时返回 false
+    bool fetch();
+
+    std::shared_ptr<const Source> source_;
+    std::unique_ptr<Batch[]> ring_;
+    // head_ 只由 Lexer 线程写，tail_ 只由 Parser 线程写；分开放在不同的缓存行上
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    std::atomic<bool> stop_{false};
+
+    // 以下只由 Parser 线程访问
+    alignas(64) Batch *batch_ = nullptr;
+    size_t index_ = 0;
+    size_t size_ = 0;
+    bool finished_ = false;
+    Token eof_;
+    double consumer_wait_seconds_ = 0;
+
+    // 以下由 Lexer 线程写，线程结束后读取
+    double lex_seconds_ = 0;
+    double lexer_wait_seconds_ = 0;
+
+    std::thread thread_;
+};
+
+#endif
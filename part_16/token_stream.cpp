@@ -0,0 +1,24 @@
+#include "token_stream.hpp"
+
+#include "parallel_lexer.hpp"
+
+std::shared_ptr<const TokenStream> TokenStream::lex(const std::shared_ptr<const Source> &source, unsigned threads) {
+    auto stream = std::make_shared<TokenStream>(source);
+    if (threads == 1) {
+        // 紧凑的代码里平均每个 token 只有 2~3 字节（含空白），先按 4 字节预留一次，减少扩容
+        stream->reserve(source->text().size() / 4 + 1);
+        auto lexer = Lexer(source);
+        Token token;
+        do {
+            token = lexer.getNextToken();
+            stream->push(token);
+        } while (token.type_ != END_OF_FILE);
+    } else {
+        auto tokens = lexParallel(source, threads);
+        stream->reserve(tokens.size());
+        for (const auto &token : tokens) {
+            stream->push(token);
+        }
+    }
+    return stream;
+}
@@ -0,0 +1,65 @@
+#ifndef TOKEN_STREAM_HPP_
+#define TOKEN_STREAM_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "lexer.hpp"
+#include "source.hpp"
+#include "token.hpp"
+
+// 预先分析好的整个 token 序列，结构体数组（SoA）布局：第 i 个 token 的类型、偏移、长度和
+// 负载（整数值、实数值或标识符编号）分别存放在 types_[i]、offsets_[i]、lengths_[i]、values_[i] 中。
+// Parser 用下标遍历，可以任意向前查看，判断类型时只读 types_，不复制 Token。
+// 最后一个 token 总是 END_OF_FILE，越界访问也返回它。
+class TokenStream {
+   public:
+    explicit TokenStream(std::shared_ptr<const Source> source) : source_(std::move(source)) {}
+
+    // 分析整个源码；threads 不为 1 时使用并行词法分析（0 表示硬件线程数）。
+    // 词法错误在这里一次性抛出，而不是在语法分析进行到那里时
+    static std::shared_ptr<const TokenStream> lex(const std::shared_ptr<const Source> &source, unsigned threads = 1);
+
+    const std::shared_ptr<const Source> &source() const { return source_; }
+
+    size_t size() const { return types_.size(); }
+
+    TokenType type(size_t i) const { return i < types_.size() ? types_[i] : END_OF_FILE; }
+
+    // 还原第 i 个 token，只在需要保存 token（建立 AST 节点、报错）时调用
+    Token token(size_t i) const {
+        if (i >= types_.size()) {
+            i = types_.size() - 1;
+        }
+        Token token(types_[i], offsets_[i], lengths_[i]);
+        std::memcpy(&token.value_, &values_[i], sizeof(int64_t));
+        return token;
+    }
+
+    void push(const Token &token) {
+        types_.push_back(token.type_);
+        offsets_.push_back(token.offset_);
+        lengths_.push_back(token.length_);
+        int64_t value;
+        std::memcpy(&value, &token.value_, sizeof(int64_t));
+        values_.push_back(value);
+    }
+
+    void reserve(size_t n) {
+        types_.reserve(n);
+        offsets_.reserve(n);
+        lengths_.reserve(n);
+        values_.reserve(n);
+    }
+
+   private:
+    std::shared_ptr<const Source> source_;
+    std::vector<TokenType> types_;
+    std::vector<uint32_t> offsets_;
+    std::vector<uint16_t> lengths_;
+    std::vector<int64_t> values_;
+};
+
+#endif
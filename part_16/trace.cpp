@@ -0,0 +1,202 @@
+#include "trace.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace trace {
+
+std::atomic<uint32_t> enabled_categories[TRACE_LEVEL_COUNT] = {};
+
+namespace {
+
+const char *prefix(uint32_t category) {
+    switch (category) {
+        case TRACE_LEXER:
+            return "[lexer] ";
+        case TRACE_PARSER:
+            return "[parser] ";
+        case TRACE_SEMANTIC:
+            return "[semantic] ";
+        case TRACE_INTERPRETER:
+            return "[interpreter] ";
+        default:
+            return "";
+    }
+}
+
+// 固定容量的环形缓冲区以及唯一的写出线程
+class Writer {
+   public:
+    static constexpr size_t CAPACITY = 4096;
+
+    Writer() : ring_(CAPACITY) {}
+
+    ~Writer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        not_empty_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    void start(FILE *output) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        output_ = output;
+        if (!thread_.joinable()) {
+            thread_ = std::thread([this] { run(); });
+        }
+    }
+
+    void push(uint32_t category, std::string message) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // 没有开启过跟踪时没有写出线程
+        if (!thread_.joinable()) {
+            return;
+        }
+        not_full_.wait(lock, [this] { return head_ - tail_ < CAPACITY; });
+        auto &entry = ring_[head_ % CAPACITY];
+        entry.category_ = category;
+        entry.message_ = std::move(message);
+        ++head_;
+        lock.unlock();
+        not_empty_.notify_one();
+    }
+
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!thread_.joinable()) {
+            return;
+        }
+        auto target = head_;
+        drained_.wait(lock, [this, target] { return written_ >= target; });
+    }
+
+   private:
+    struct Entry {
+        uint32_t category_ = 0;
+        std::string message_;
+    };
+
+    // 每次取出缓冲区中的全部记录，解锁之后再写出
+    void run() {
+        std::vector<Entry> batch;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            not_empty_.wait(lock, [this] { return head_ != tail_ || stopping_; });
+            if (head_ == tail_) {
+                return;
+            }
+            for (; tail_ != head_; ++tail_) {
+                batch.push_back(std::move(ring_[tail_ % CAPACITY]));
+            }
+            auto output = output_;
+            lock.unlock();
+            not_full_.notify_all();
+            for (const auto &entry : batch) {
+                std::fputs(prefix(entry.category_), output);
+                std::fwrite(entry.message_.data(), 1, entry.message_.size(), output);
+                std::fputc('\n', output);
+            }
+            std::fflush(output);
+            batch.clear();
+            lock.lock();
+            written_ = tail_;
+            drained_.notify_all();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::condition_variable drained_;
+    std::vector<Entry> ring_;
+    // 单调递增的计数，在 ring_ 中的位置为对 CAPACITY 取模
+    uint64_t head_ = 0;
+    uint64_t tail_ = 0;
+    uint64_t written_ = 0;
+    bool stopping_ = false;
+    FILE *output_ = stderr;
+    std::thread thread_;
+};
+
+// 进程退出时写出剩余的记录
+Writer &writer() {
+    static Writer instance;
+    return instance;
+}
+
+uint32_t categoryOf(std::string_view name) {
+    if (name == "lexer") {
+        return TRACE_LEXER;
+    } else if (name == "parser") {
+        return TRACE_PARSER;
+    } else if (name == "semantic") {
+        return TRACE_SEMANTIC;
+    } else if (name == "interpreter") {
+        return TRACE_INTERPRETER;
+    } else if (name == "all") {
+        return TRACE_ALL;
+    }
+    return 0;
+}
+
+}  // namespace
+
+void enable(uint32_t categories, TraceLevel level, FILE *output) {
+    writer().start(output);
+    for (int i = 0; i <= level; ++i) {
+        enabled_categories[i].fetch_or(categories, std::memory_order_relaxed);
+    }
+}
+
+void disable(uint32_t categories) {
+    for (auto &enabled : enabled_categories) {
+        enabled.fetch_and(~categories, std::memory_order_relaxed);
+    }
+}
+
+// 逗号分隔的 "分类[:级别]"，级别为 info（默认）或者 debug。全部合法时才开启
+bool configure(std::string_view spec) {
+    std::vector<std::pair<uint32_t, TraceLevel>> items;
+    do {
+        auto comma = spec.find(',');
+        auto item = spec.substr(0, comma);
+        spec = comma == std::string_view::npos ? std::string_view() : spec.substr(comma + 1);
+        auto level = TRACE_INFO;
+        auto colon = item.find(':');
+        if (colon != std::string_view::npos) {
+            auto name = item.substr(colon + 1);
+            if (name == "debug") {
+                level = TRACE_DEBUG;
+            } else if (name != "info") {
+                return false;
+            }
+            item = item.substr(0, colon);
+        }
+        auto category = categoryOf(item);
+        if (category == 0) {
+            return false;
+        }
+        items.emplace_back(category, level);
+    } while (!spec.empty());
+    for (auto [category, level] : items) {
+        enable(category, level);
+    }
+    return true;
+}
+
+void flush() {
+    writer().flush();
+}
+
+void write(uint32_t category, std::string message) {
+    writer().push(category, std::move(message));
+}
+
+}  // namespace trace
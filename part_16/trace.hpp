@@ -0,0 +1,97 @@
+#ifndef TRACE_HPP_
+#define TRACE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+// 跟踪输出的分类，可以按位组合
+enum TraceCategory : uint32_t {
+    TRACE_LEXER = 1 << 0,        // 每个 token
+    TRACE_PARSER = 1 << 1,       // 过程声明、过程体的建立
+    TRACE_SEMANTIC = 1 << 2,     // 作用域的进出、名字查找、作用域内容
+    TRACE_INTERPRETER = 1 << 3,  // 程序的执行、赋值
+    TRACE_ALL = (1 << 4) - 1,
+};
+
+// 级别越高输出越多：开启 TRACE_DEBUG 时同时开启 TRACE_INFO
+enum TraceLevel : uint8_t {
+    TRACE_INFO,
+    TRACE_DEBUG,
+    TRACE_LEVEL_COUNT,
+};
+
+// 编译进来的分类，构建时用 -DPASCAL_TRACE_CATEGORIES=<掩码> 指定，默认全部。
+// 没有编译进来的分类，TRACE 展开后不生成任何代码
+#ifndef PASCAL_TRACE_CATEGORIES
+#define PASCAL_TRACE_CATEGORIES TRACE_ALL
+#endif
+
+// 跟踪输出先格式化为一条记录放入环形缓冲区，由后台线程批量写出，产生记录的线程不等待 I/O。
+// 缓冲区满时产生记录的线程等待，记录不会丢失；同一线程产生的记录按顺序写出
+namespace trace {
+
+constexpr bool compiledIn(uint32_t category) {
+    return (PASCAL_TRACE_CATEGORIES & category) != 0;
+}
+
+// 各级别开启的分类，运行时只读一次这个掩码
+extern std::atomic<uint32_t> enabled_categories[TRACE_LEVEL_COUNT];
+
+inline bool enabled(uint32_t category, TraceLevel level) {
+    return (enabled_categories[level].load(std::memory_order_relaxed) & category) != 0;
+}
+
+// 开启 categories 中各分类直到 level 的输出，第一次开启时启动写出线程。output 默认为 stderr
+void enable(uint32_t categories, TraceLevel level, FILE *output = stderr);
+
+// 关闭 categories 的所有级别；写出线程保留，已经产生的记录照常写出
+void disable(uint32_t categories);
+
+// 解析命令行中的 "lexer:debug,semantic"、"all" 等，格式错误时返回 false
+bool configure(std::string_view spec);
+
+// 等待已经产生的记录全部写出
+void flush();
+
+// 放入环形缓冲区，category 用作每行的前缀
+void write(uint32_t category, std::string message);
+
+// 一条记录：用 << 拼接内容，析构时放入环形缓冲区
+class Record {
+   public:
+    explicit Record(uint32_t category) : category_(category) {}
+
+    Record(const Record &) = delete;
+    Record &operator=(const Record &) = delete;
+
+    ~Record() { write(category_, out_.str()); }
+
+    template <typename T>
+    Record &operator<<(const T &value) {
+        out_ << value;
+        return *this;
+    }
+
+   private:
+    uint32_t category_;
+    std::ostringstream out_;
+};
+
+}  // namespace trace
+
+// 例如 TRACE(TRACE_SEMANTIC, TRACE_DEBUG, "lookup: " << name)。
+// 分类没有编译进来时整条语句被丢弃；编译进来但没有开启时只有一次原子读和一次比较，参数不会求值
+#define TRACE(category, level, ...)                          \
+    do {                                                     \
+        if constexpr (trace::compiledIn(category)) {         \
+            if (trace::enabled(category, level)) {           \
+                trace::Record(category) << __VA_ARGS__;      \
+            }                                                \
+        }                                                    \
+    } while (0)
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef VALUE_HPP_
+#define VALUE_HPP_
+
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+
+// 语义分析为每个表达式推导出的静态类型
+enum ValueType : uint8_t {
+    TYPE_UNKNOWN,  // 尚未分析，或者名字不是变量（执行时报告变量未定义）
+    TYPE_INTEGER,
+    TYPE_REAL,
+};
+
+// 与内建类型的名字一致
+inline const char *typeName(ValueType type) {
+    return type == TYPE_INTEGER ? "INTEGER" : type == TYPE_REAL ? "REAL" : "UNKNOWN";
+}
+
+inline std::ostream &operator<<(std::ostream &out, ValueType type) {
+    return out << typeName(type);
+}
+
+// 执行时的值。类型在语义分析时已经确定，值本身不带类型标记，由执行引擎按静态类型读取
+union Value {
+    int64_t integer_;
+    double real_;
+};
+
+inline Value integerValue(int64_t value) {
+    Value result;
+    result.integer_ = value;
+    return result;
+}
+
+inline Value realValue(double value) {
+    Value result;
+    result.real_ = value;
+    return result;
+}
+
+// 按静态类型读取为 double，用于输出以及 INTEGER 向 REAL 的提升
+inline double toReal(Value value, ValueType type) {
+    return type == TYPE_INTEGER ? static_cast<double>(value.integer_) : value.real_;
+}
+
+// INTEGER 的 DIV，向零取整。除数为 0 以及 INT64_MIN DIV -1 溢出时与未定义的变量一样在执行时报告
+inline int64_t integerDivide(int64_t left, int64_t right) {
+    if (right == 0) {
+        throw std::runtime_error("division by zero");
+    }
+    if (right == -1 && left == INT64_MIN) {
+        throw std::runtime_error("integer overflow in DIV");
+    }
+    return left / right;
+}
+
+// INTEGER 的 +、-、* 与一元 -，结果超出 int64_t 时同样在执行时报告，不回绕
+inline int64_t integerAdd(int64_t left, int64_t right) {
+    int64_t result;
+    if (__builtin_add_overflow(left, right, &result)) {
+        throw std::runtime_error("integer overflow in +");
+    }
+    return result;
+}
+
+inline int64_t integerSubtract(int64_t left, int64_t right) {
+    int64_t result;
+    if (__builtin_sub_overflow(left, right, &result)) {
+        throw std::runtime_error("integer overflow in -");
+    }
+    return result;
+}
+
+inline int64_t integerMultiply(int64_t left, int64_t right) {
+    int64_t result;
+    if (__builtin_mul_overflow(left, right, &result)) {
+        throw std::runtime_error("integer overflow in *");
+    }
+    return result;
+}
+
+inline int64_t integerNegate(int64_t value) {
+    if (value == INT64_MIN) {
+        throw std::runtime_error("integer overflow in unary -");
+    }
+    return -value;
+}
+
+#endif
@@ -0,0 +1,133 @@
+#include "vm.hpp"
+
+#include <iostream>
+
+#include "trace.hpp"
+
+void VM::run() {
+    std::cout << program_.name_ << ": " << std::endl;
+    TRACE(TRACE_INTERPRETER, TRACE_INFO, "run " << program_.name_ << " (vm, " << program_.code_.size() << " instructions)");
+    execute();
+}
+
+void VM::printGlobalScope() {
+    auto scope = globals();
+    std::cout << "GLOBAL_SCOPE.size() = " << scope.size() << std::endl;
+    for (const auto &[identifier, value] : scope) {
+        std::cout << identifiers().name(identifier) << ": " << value << std::endl;
+    }
+}
+
+std::unordered_map<Identifier, double> VM::globals() const {
+    std::unordered_map<Identifier, double> scope;
+    for (auto reg : program_.assigned_) {
+        scope[program_.variables_[reg]] = toReal(registers_[reg], program_.variable_types_[reg]);
+    }
+    return scope;
+}
+
+// 主循环：GCC/Clang 下使用 computed goto 直接跳转，其它编译器退化为 switch
+void VM::execute() {
+    registers_.assign(program_.register_count_, Value());
+    Value *R = registers_.data();
+    spill_.assign(program_.spill_count_, Value());
+    Value *S = spill_.data();
+    const double *K = program_.constants_.data();
+    const int64_t *I = program_.integer_constants_.data();
+    const Instruction *pc = program_.code_.data();
+
+#if defined(__GNUC__)
+    static void *dispatch_table[] = {
+        &&op_LOADK, &&op_MOVE, &&op_ADD,  &&op_SUB,  &&op_MUL,  &&op_IDIV, &&op_FDIV, &&op_NEG,
+        &&op_HALT,  &&op_LOADI, &&op_IADD, &&op_ISUB, &&op_IMUL, &&op_INEG, &&op_ITOF,
+        &&op_SPILL, &&op_RELOAD,
+    };
+#define DISPATCH() goto *dispatch_table[pc->op_]
+#define CASE(op) op_##op:
+#define NEXT() \
+    ++pc;      \
+    DISPATCH()
+
+    DISPATCH();
+#else
+#define CASE(op) case OP_##op:
+#define NEXT() \
+    ++pc;      \
+    continue
+
+    for (;;) {
+        switch (pc->op_) {
+#endif
+    CASE(LOADK) {
+        R[pc->a_].real_ = K[pc->bx()];
+        NEXT();
+    }
+    CASE(LOADI) {
+        R[pc->a_].integer_ = I[pc->bx()];
+        NEXT();
+    }
+    CASE(MOVE) {
+        R[pc->a_] = R[pc->b_];
+        NEXT();
+    }
+    CASE(ADD) {
+        R[pc->a_].real_ = R[pc->b_].real_ + R[pc->c_].real_;
+        NEXT();
+    }
+    CASE(SUB) {
+        R[pc->a_].real_ = R[pc->b_].real_ - R[pc->c_].real_;
+        NEXT();
+    }
+    CASE(MUL) {
+        R[pc->a_].real_ = R[pc->b_].real_ * R[pc->c_].real_;
+        NEXT();
+    }
+    CASE(FDIV) {
+        R[pc->a_].real_ = R[pc->b_].real_ / R[pc->c_].real_;
+        NEXT();
+    }
+    CASE(NEG) {
+        R[pc->a_].real_ = -R[pc->b_].real_;
+        NEXT();
+    }
+    CASE(IADD) {
+        R[pc->a_].integer_ = integerAdd(R[pc->b_].integer_, R[pc->c_].integer_);
+        NEXT();
+    }
+    CASE(ISUB) {
+        R[pc->a_].integer_ = integerSubtract(R[pc->b_].integer_, R[pc->c_].integer_);
+        NEXT();
+    }
+    CASE(IMUL) {
+        R[pc->a_].integer_ = integerMultiply(R[pc->b_].integer_, R[pc->c_].integer_);
+        NEXT();
+    }
+    CASE(IDIV) {
+        R[pc->a_].integer_ = integerDivide(R[pc->b_].integer_, R[pc->c_].integer_);
+        NEXT();
+    }
+    CASE(INEG) {
+        R[pc->a_].integer_ = integerNegate(R[pc->b_].integer_);
+        NEXT();
+    }
+    CASE(ITOF) {
+        R[pc->a_].real_ = static_cast<double>(R[pc->b_].integer_);
+        NEXT();
+    }
+    CASE(SPILL) {
+        S[pc->bx()] = R[pc->a_];
+        NEXT();
+    }
+    CASE(RELOAD) {
+        R[pc->a_] = S[pc->bx()];
+        NEXT();
+    }
+    CASE(HALT) { return; }
+#if !defined(__GNUC__)
+        }
+    }
+#endif
+#undef DISPATCH
+#undef CASE
+#undef NEXT
+}
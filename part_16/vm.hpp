@@ -0,0 +1,34 @@
+#ifndef VM_HPP_
+#define VM_HPP_
+
+#include <unordered_map>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "identifier.hpp"
+
+// 执行 BytecodeCompiler 生成的字节码。寄存器按指令的类型读写，执行时不检查类型
+class VM {
+   public:
+    explicit VM(BytecodeProgram program) : program_(std::move(program)) {}
+
+    // 执行整个程序，可重复调用
+    void run();
+
+    // 按 Interpreter 的格式输出全局作用域
+    void printGlobalScope();
+
+    // 以驻留编号作为 key
+    std::unordered_map<Identifier, double> globals() const;
+
+    const BytecodeProgram &program() const { return program_; }
+
+   private:
+    void execute();
+
+    BytecodeProgram program_;
+    std::vector<Value> registers_;
+    std::vector<Value> spill_;
+};
+
+#endif